@@ -18,12 +18,45 @@ class CalculatorController {
     return model_.GetResultString();
   };
 
-  std::pair<std::list<double>, std::list<double>> CalculateDots(
-      const std::string &expression, std::vector<double> plot_limits) {
-    model_.CalculateDots(expression, std::move(plot_limits));
-    return model_.GetDots();
+  Dual Differentiate(const std::string &expression) {
+    return model_.Differentiate(expression);
   };
 
+  std::vector<double> FindRoots(const std::string &expression, double x_min,
+                                double x_max) {
+    return model_.FindRoots(expression, x_min, x_max);
+  };
+
+  Integral Integrate(const std::string &expression, double a, double b) {
+    return model_.Integrate(expression, a, b);
+  };
+
+  bool CalculateBatch(const std::string &expression, const double *x_values,
+                      double *results, size_t count) {
+    return model_.CalculateBatch(expression, x_values, results, count);
+  };
+
+  std::vector<Dot> CalculateDots(const std::string &expression,
+                                 std::vector<double> plot_limits,
+                                 PlotBudget budget = {}) {
+    model_.CalculateDots(expression, std::move(plot_limits), budget);
+    return model_.TakeDots();
+  };
+  bool IsPlotPartial() const { return model_.IsPlotPartial(); }
+
+  // Returns a handle to run on a worker thread, to follow its progress and
+  // to cancel it.
+  std::shared_ptr<PlotJob> CalculateDotsAsync(const std::string &expression,
+                                              std::vector<double> plot_limits,
+                                              PlotBudget budget = {}) {
+    return model_.PreparePlot(expression, std::move(plot_limits), budget);
+  };
+
+  size_t GetErrorPosition() const { return model_.GetErrorPosition(); }
+  std::string GetKernelsName() const { return model_.GetKernelsName(); }
+  size_t GetCacheHits() const { return model_.GetCacheHits(); }
+  size_t GetCacheMisses() const { return model_.GetCacheMisses(); }
+
  private:
   CalculatorModel &model_;
 
@@ -0,0 +1,498 @@
+#include "compiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+s21::Compiler::Node s21::Compiler::AddConstant(double value) {
+  return Append({Kind::kConstant, OpCode{}, 0, 0, 0, value, false});
+}
+
+s21::Compiler::Node s21::Compiler::AddVariable() {
+  return Append({Kind::kVariable, OpCode{}, 0, 0, 0, 0, true});
+}
+
+s21::Compiler::Node s21::Compiler::AddParameter(double value) {
+  return Append({Kind::kParameter, OpCode{}, 0, 0, 0, value, false});
+}
+
+s21::Compiler::Node s21::Compiler::AddOperation(OpCode code, Node lhs,
+                                                Node rhs) {
+  if (Program::IsUnary(code)) {
+    rhs = lhs;
+  }
+  Node node = Simplify(code, lhs, rhs);
+  std::vector<double> terms;
+  if (IsConstant(node) || polynomials_.count(node) ||
+      !Expand(code, lhs, rhs, terms)) {
+    return node;
+  }
+  // Without a constant term the Horner form ends in a product, whose zero
+  // may have a different sign than the sum it replaces.
+  if ((code == OpCode::kAdd || code == OpCode::kSub) && terms.size() > 2 &&
+      terms[0] != 0) {
+    Node horner = AddHorner(terms);
+    if (CountOperations(horner) < CountOperations(node)) {
+      node = horner;
+    }
+  }
+  polynomials_.emplace(node, std::move(terms));
+  return node;
+}
+
+s21::Compiler::Node s21::Compiler::Simplify(OpCode code, Node lhs,
+                                            Node rhs) {
+  if (IsConstant(lhs) && IsConstant(rhs)) {
+    return AddConstant(Fold(code, nodes_[lhs].value, nodes_[rhs].value));
+  }
+  switch (code) {
+    case OpCode::kNeg:
+      if (IsOperation(lhs, OpCode::kNeg)) {
+        return nodes_[lhs].lhs;
+      }
+      break;
+    case OpCode::kAdd:
+      if (IsZero(lhs, true)) {
+        return rhs;
+      }
+      if (IsZero(rhs, true)) {
+        return lhs;
+      }
+      break;
+    case OpCode::kSub:
+      if (IsZero(rhs, false)) {
+        return lhs;
+      }
+      if (IsZero(lhs, true)) {
+        return AddOperation(OpCode::kNeg, rhs);
+      }
+      break;
+    case OpCode::kMul:
+      if (IsConstant(lhs, 1)) {
+        return rhs;
+      }
+      if (IsConstant(rhs, 1)) {
+        return lhs;
+      }
+      if (IsConstant(lhs, -1)) {
+        return AddOperation(OpCode::kNeg, rhs);
+      }
+      if (IsConstant(rhs, -1)) {
+        return AddOperation(OpCode::kNeg, lhs);
+      }
+      break;
+    case OpCode::kDiv:
+      if (IsConstant(rhs, 1)) {
+        return lhs;
+      }
+      if (IsConstant(rhs, -1)) {
+        return AddOperation(OpCode::kNeg, lhs);
+      }
+      break;
+    case OpCode::kPow:
+      if (IsConstant(rhs, 0)) {
+        return AddConstant(1);
+      }
+      if (IsConstant(rhs) && std::trunc(nodes_[rhs].value) ==
+                                 nodes_[rhs].value &&
+          std::fabs(nodes_[rhs].value) <= kMaxPowerExponent) {
+        return AddPower(lhs, static_cast<int>(nodes_[rhs].value));
+      }
+      break;
+    default:
+      break;
+  }
+  if ((code == OpCode::kAdd || code == OpCode::kMul) && lhs > rhs) {
+    std::swap(lhs, rhs);
+  }
+  return Append({Kind::kOperation, code, lhs, rhs, 0, 0,
+                 nodes_[lhs].varying || nodes_[rhs].varying});
+}
+
+// Exponentiation by squaring, x^-n being 1/x^n.
+s21::Compiler::Node s21::Compiler::AddPower(Node base, int exponent) {
+  Node power = base;
+  bool empty = true;
+  for (int n = std::abs(exponent);; n /= 2) {
+    if (n % 2 == 1) {
+      power = empty ? base : AddOperation(OpCode::kMul, power, base);
+      empty = false;
+    }
+    if (n < 2) {
+      break;
+    }
+    base = AddOperation(OpCode::kMul, base, base);
+  }
+  return exponent < 0 ? AddOperation(OpCode::kDiv, AddConstant(1), power)
+                      : power;
+}
+
+s21::Compiler::Node s21::Compiler::AddFma(Node lhs, Node rhs, Node addend) {
+  if (IsConstant(lhs) && IsConstant(rhs) && IsConstant(addend)) {
+    return AddConstant(Fold(OpCode::kFma, nodes_[lhs].value,
+                            nodes_[rhs].value, nodes_[addend].value));
+  }
+  if (IsConstant(addend, 0)) {
+    return AddOperation(OpCode::kMul, lhs, rhs);
+  }
+  if (IsConstant(lhs, 1)) {
+    return AddOperation(OpCode::kAdd, rhs, addend);
+  }
+  if (IsConstant(rhs, 1)) {
+    return AddOperation(OpCode::kAdd, lhs, addend);
+  }
+  if (lhs > rhs) {
+    std::swap(lhs, rhs);
+  }
+  return Append({Kind::kOperation, OpCode::kFma, lhs, rhs, addend, 0,
+                 nodes_[lhs].varying || nodes_[rhs].varying ||
+                     nodes_[addend].varying});
+}
+
+// The polynomial computed by the operation, if its operands are ones and
+// the result is still a sum of terms c*X^k. Only products with a single
+// term are multiplied out.
+bool s21::Compiler::Expand(OpCode code, Node lhs, Node rhs,
+                           std::vector<double> &terms) const {
+  std::vector<double> left, right;
+  if (!GetPolynomial(lhs, left) || !GetPolynomial(rhs, right)) {
+    return false;
+  }
+  auto is_term = [](const std::vector<double> &polynomial) {
+    return std::count(polynomial.begin(), polynomial.end(), 0.0) + 1 >=
+           static_cast<std::ptrdiff_t>(polynomial.size());
+  };
+  switch (code) {
+    case OpCode::kNeg:
+      for (double coefficient : left) {
+        terms.push_back(-coefficient);
+      }
+      break;
+    case OpCode::kAdd:
+    case OpCode::kSub:
+      terms.resize(std::max(left.size(), right.size()));
+      for (size_t k = 0; k < terms.size(); ++k) {
+        double a = k < left.size() ? left[k] : 0;
+        double b = k < right.size() ? right[k] : 0;
+        terms[k] = code == OpCode::kAdd ? a + b : a - b;
+      }
+      break;
+    case OpCode::kMul:
+      if (!is_term(left) && !is_term(right)) {
+        return false;
+      }
+      terms.resize(left.size() + right.size() - 1);
+      for (size_t i = 0; i < left.size(); ++i) {
+        for (size_t j = 0; j < right.size(); ++j) {
+          if (left[i] != 0 && right[j] != 0) {
+            terms[i + j] += left[i] * right[j];
+          }
+        }
+      }
+      break;
+    default:
+      return false;
+  }
+  while (terms.size() > 1 && terms.back() == 0) {
+    terms.pop_back();
+  }
+  return terms.size() <= kMaxDegree + 1;
+}
+
+bool s21::Compiler::GetPolynomial(Node node,
+                                  std::vector<double> &terms) const {
+  const Entry &entry = nodes_[node];
+  if (entry.kind == Kind::kConstant) {
+    terms = {entry.value};
+  } else if (entry.kind == Kind::kVariable) {
+    terms = {0, 1};
+  } else {
+    auto found = polynomials_.find(node);
+    if (found == polynomials_.end()) {
+      return false;
+    }
+    terms = found->second;
+  }
+  return true;
+}
+
+s21::Compiler::Node s21::Compiler::AddHorner(
+    const std::vector<double> &terms) {
+  Node x = AddVariable();
+  Node sum = AddConstant(terms.back());
+  for (size_t k = terms.size() - 1; k-- > 0;) {
+    sum = AddFma(sum, x, AddConstant(terms[k]));
+  }
+  return sum;
+}
+
+// Instructions evaluated per sample for the subtree of root.
+size_t s21::Compiler::CountOperations(Node root) const {
+  size_t count = 0;
+  for (Node node : Schedule(root)) {
+    if (nodes_[node].kind == Kind::kOperation && nodes_[node].varying) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void s21::Compiler::Emit(Node root, Program &program) const {
+  std::vector<Register> registers(nodes_.size());
+  for (Node node = 0; node < nodes_.size(); ++node) {
+    if (nodes_[node].kind == Kind::kParameter) {
+      registers[node] = program.AddParameter(nodes_[node].value);
+    }
+  }
+  std::vector<Node> order = Schedule(root);
+  std::vector<size_t> uses(nodes_.size());
+  std::vector<bool> scheduled(nodes_.size());
+  std::vector<bool> emitted(nodes_.size());
+  for (Node node : order) {
+    scheduled[node] = true;
+    if (nodes_[node].kind == Kind::kOperation) {
+      ++uses[nodes_[node].lhs];
+      ++uses[nodes_[node].rhs];
+      if (nodes_[node].code == OpCode::kFma) {
+        ++uses[nodes_[node].addend];
+      }
+    }
+  }
+  std::unordered_map<Node, Fusion> fusions;
+  for (Node node : order) {
+    Fusion fusion{};
+    if (Fuse(node, uses, fusion)) {
+      emitted[fusion.product] = true;
+      fusions.emplace(node, fusion);
+    }
+  }
+  std::vector<Register> free;
+  auto release = [&](Node operand) {
+    if (--uses[operand] == 0 && nodes_[operand].varying &&
+        nodes_[operand].kind == Kind::kOperation) {
+      free.push_back(registers[operand]);
+    }
+  };
+  auto allocate = [&]() {
+    if (free.empty()) {
+      return program.AddRegister();
+    }
+    Register reg = free.back();
+    free.pop_back();
+    return reg;
+  };
+  for (Node node : order) {
+    const Entry &entry = nodes_[node];
+    if (emitted[node]) {
+      continue;
+    }
+    if (entry.kind == Kind::kConstant) {
+      registers[node] = program.AddConstant(entry.value);
+    } else if (entry.kind == Kind::kVariable) {
+      registers[node] = Program::kXRegister;
+    } else if (entry.kind == Kind::kOperation && !entry.varying) {
+      registers[node] = program.AddRegister();
+      program.EmitInvariant(entry.code, registers[node],
+                            registers[entry.lhs], registers[entry.rhs],
+                            registers[entry.addend]);
+    } else if (fusions.count(node)) {
+      const Fusion &fusion = fusions.at(node);
+      release(fusion.lhs);
+      release(fusion.rhs);
+      release(fusion.addend);
+      auto operand = [&](Node source, bool negate) {
+        return negate ? program.AddConstant(-nodes_[source].value)
+                      : registers[source];
+      };
+      registers[node] = allocate();
+      program.Emit(OpCode::kFma, registers[node], registers[fusion.lhs],
+                   operand(fusion.rhs, fusion.negate_rhs),
+                   operand(fusion.addend, fusion.negate_addend));
+    } else if (entry.kind == Kind::kOperation) {
+      release(entry.lhs);
+      release(entry.rhs);
+      if (entry.code == OpCode::kFma) {
+        release(entry.addend);
+      }
+      Node partner = FindPartner(node);
+      if (partner != node && scheduled[partner]) {
+        release(entry.lhs);
+        release(entry.rhs);
+        Node sin = entry.code == OpCode::kSin ? node : partner;
+        Node cos = entry.code == OpCode::kSin ? partner : node;
+        registers[sin] = allocate();
+        registers[cos] = allocate();
+        program.Emit(OpCode::kSinCos, registers[sin], registers[entry.lhs],
+                     registers[cos]);
+        emitted[partner] = true;
+      } else {
+        registers[node] = allocate();
+        program.Emit(entry.code, registers[node], registers[entry.lhs],
+                     registers[entry.rhs], registers[entry.addend]);
+      }
+    }
+  }
+  program.SetResult(registers[root]);
+}
+
+size_t s21::Compiler::KeyHash::operator()(const Key &key) const {
+  size_t hash = std::hash<int>()(static_cast<int>(key.kind));
+  hash = hash * 31 + std::hash<int>()(static_cast<int>(key.code));
+  hash = hash * 31 + std::hash<Node>()(key.lhs);
+  hash = hash * 31 + std::hash<Node>()(key.rhs);
+  hash = hash * 31 + std::hash<Node>()(key.addend);
+  return hash * 31 + std::hash<uint64_t>()(key.value);
+}
+
+s21::Compiler::Key s21::Compiler::MakeKey(const Entry &entry) {
+  Key key = {entry.kind, entry.code, entry.lhs, entry.rhs, entry.addend, 0};
+  std::memcpy(&key.value, &entry.value, sizeof(key.value));
+  return key;
+}
+
+// Parameters are distinct inputs even when they start at the same value.
+s21::Compiler::Node s21::Compiler::Append(const Entry &entry) {
+  bool shared = entry.kind != Kind::kParameter;
+  if (shared) {
+    auto found = index_.find(MakeKey(entry));
+    if (found != index_.end()) {
+      return found->second;
+    }
+  }
+  nodes_.push_back(entry);
+  Node node = static_cast<Node>(nodes_.size() - 1);
+  if (shared) {
+    index_.emplace(MakeKey(entry), node);
+  }
+  return node;
+}
+
+// The cosine of the operand of a sine node or the other way round, if the
+// tree has one, and node itself otherwise.
+s21::Compiler::Node s21::Compiler::FindPartner(Node node) const {
+  const Entry &entry = nodes_[node];
+  if (entry.code != OpCode::kSin && entry.code != OpCode::kCos) {
+    return node;
+  }
+  Entry partner = entry;
+  partner.code = entry.code == OpCode::kSin ? OpCode::kCos : OpCode::kSin;
+  auto found = index_.find(MakeKey(partner));
+  return found == index_.end() ? node : found->second;
+}
+
+// a*b+c, c+a*b, a*b-k and c-a*k, with k a constant, as a single kFma when
+// the product a*b has no other use.
+bool s21::Compiler::Fuse(Node node, const std::vector<size_t> &uses,
+                         Fusion &fusion) const {
+  const Entry &entry = nodes_[node];
+  auto fusible = [&](Node operand) {
+    return IsOperation(operand, OpCode::kMul) && nodes_[operand].varying &&
+           uses[operand] == 1;
+  };
+  if (!entry.varying || (!IsOperation(node, OpCode::kAdd) &&
+                         !IsOperation(node, OpCode::kSub))) {
+    return false;
+  }
+  Node product = entry.lhs;
+  Node addend = entry.rhs;
+  if (entry.code == OpCode::kAdd) {
+    if (!fusible(product)) {
+      std::swap(product, addend);
+    }
+    if (!fusible(product)) {
+      return false;
+    }
+    fusion = {product, nodes_[product].lhs, nodes_[product].rhs, addend,
+              false, false};
+    return true;
+  }
+  if (fusible(product) && IsConstant(addend)) {
+    fusion = {product, nodes_[product].lhs, nodes_[product].rhs, addend,
+              false, true};
+    return true;
+  }
+  std::swap(product, addend);
+  if (!fusible(product)) {
+    return false;
+  }
+  Node lhs = nodes_[product].lhs;
+  Node rhs = nodes_[product].rhs;
+  if (IsConstant(lhs)) {
+    std::swap(lhs, rhs);
+  }
+  if (!IsConstant(rhs)) {
+    return false;
+  }
+  fusion = {product, lhs, rhs, addend, true, false};
+  return true;
+}
+
+// Nodes reachable from the root in post order, each listed once.
+std::vector<s21::Compiler::Node> s21::Compiler::Schedule(Node root) const {
+  std::vector<Node> order;
+  std::vector<bool> visited(nodes_.size());
+  std::vector<std::pair<Node, bool>> stack = {{root, false}};
+  while (!stack.empty()) {
+    auto [node, expanded] = stack.back();
+    stack.pop_back();
+    if (expanded) {
+      order.push_back(node);
+    } else if (!visited[node]) {
+      visited[node] = true;
+      stack.emplace_back(node, true);
+      if (nodes_[node].kind == Kind::kOperation) {
+        if (nodes_[node].code == OpCode::kFma) {
+          stack.emplace_back(nodes_[node].addend, false);
+        }
+        stack.emplace_back(nodes_[node].rhs, false);
+        stack.emplace_back(nodes_[node].lhs, false);
+      }
+    }
+  }
+  return order;
+}
+
+double s21::Compiler::Fold(OpCode code, double lhs, double rhs,
+                           double addend) {
+  switch (code) {
+    case OpCode::kNeg:
+      return -lhs;
+    case OpCode::kSqrt:
+      return std::sqrt(lhs);
+    case OpCode::kLn:
+      return std::log(lhs);
+    case OpCode::kLog10:
+      return std::log10(lhs);
+    case OpCode::kSin:
+    case OpCode::kSinCos:
+      return std::sin(lhs);
+    case OpCode::kCos:
+      return std::cos(lhs);
+    case OpCode::kTan:
+      return std::tan(lhs);
+    case OpCode::kArcSin:
+      return std::asin(lhs);
+    case OpCode::kArcCos:
+      return std::acos(lhs);
+    case OpCode::kArcTan:
+      return std::atan(lhs);
+    case OpCode::kAdd:
+      return lhs + rhs;
+    case OpCode::kSub:
+      return lhs - rhs;
+    case OpCode::kMul:
+      return lhs * rhs;
+    case OpCode::kDiv:
+      return lhs / rhs;
+    case OpCode::kMod:
+      return std::fmod(lhs, rhs);
+    case OpCode::kPow:
+      return std::pow(lhs, rhs);
+    case OpCode::kFma:
+      return std::fma(lhs, rhs, addend);
+  }
+  return lhs;
+}
@@ -0,0 +1,134 @@
+#ifndef SRC_MODEL_COMPILER_H_
+#define SRC_MODEL_COMPILER_H_
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "program.h"
+
+namespace s21 {
+
+// Tree form of an expression, built bottom-up from its postfix tokens and
+// emitted as a register program. Nodes are simplified as they are added:
+// operations on constants are folded, the identities x*1, x/1, x+(-0),
+// x-0, x^1, x^0 and --x are dropped, and powers with a small integer
+// exponent become multiplications by repeated squaring. Sums of terms
+// c*X^k are tracked as polynomials in X and rewritten in Horner form, one
+// kFma per degree, when they have a constant term and that takes fewer
+// instructions; products of sums are not expanded, as expanding them can
+// cancel badly.
+// Nodes are also hash-consed, with the operands of + and * in a canonical
+// order, so every distinct subexpression is a single node and the tree is
+// in fact a DAG. A node is evaluated once, into a register that is reused
+// after its last use, and the sine and cosine of the same operand are
+// computed by one kSinCos instruction. A product used only by a sum or a
+// difference is fused with it into one kFma instruction.
+//
+// Each node records whether it depends on X. Subtrees that do not, but
+// cannot be folded because they involve a parameter, go to the invariant
+// section of the program and keep their registers for all samples.
+class Compiler {
+ public:
+  using Node = uint32_t;
+
+  Node AddConstant(double value);
+  Node AddVariable();
+  // Parameters are numbered in the order they are added, starting from 0,
+  // and start at value.
+  Node AddParameter(double value);
+  // Unary operations take their operand as lhs and ignore rhs.
+  Node AddOperation(OpCode code, Node lhs, Node rhs = 0);
+  void Emit(Node root, Program &program) const;
+
+ private:
+  // Larger integer powers keep kPow: the rounding errors of the squarings
+  // add up and would change the printed digits.
+  static constexpr int kMaxPowerExponent = 4;
+  static constexpr size_t kMaxDegree = 32;
+
+  enum class Kind : uint8_t { kConstant, kVariable, kParameter, kOperation };
+
+  struct Entry {
+    Kind kind;
+    OpCode code;
+    Node lhs;
+    Node rhs;
+    Node addend;
+    double value;
+    bool varying;
+  };
+
+  struct Key {
+    Kind kind;
+    OpCode code;
+    Node lhs;
+    Node rhs;
+    Node addend;
+    uint64_t value;
+
+    bool operator==(const Key &other) const {
+      return kind == other.kind && code == other.code && lhs == other.lhs &&
+             rhs == other.rhs && addend == other.addend &&
+             value == other.value;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+
+  // Operands of a kFma replacing a sum and its product operand. The
+  // constants flagged as negated are emitted with the opposite sign.
+  struct Fusion {
+    Node product;
+    Node lhs;
+    Node rhs;
+    Node addend;
+    bool negate_rhs;
+    bool negate_addend;
+  };
+
+  std::vector<Entry> nodes_{};
+  std::unordered_map<Key, Node, KeyHash> index_{};
+  // Coefficients of the nodes that are sums of terms c*X^k, from the
+  // constant term up.
+  std::unordered_map<Node, std::vector<double>> polynomials_{};
+
+  Node Simplify(OpCode code, Node lhs, Node rhs);
+  Node AddPower(Node base, int exponent);
+  Node AddFma(Node lhs, Node rhs, Node addend);
+  bool Expand(OpCode code, Node lhs, Node rhs,
+              std::vector<double> &terms) const;
+  bool GetPolynomial(Node node, std::vector<double> &terms) const;
+  Node AddHorner(const std::vector<double> &terms);
+  size_t CountOperations(Node root) const;
+  static Key MakeKey(const Entry &entry);
+  Node Append(const Entry &entry);
+  Node FindPartner(Node node) const;
+  bool Fuse(Node node, const std::vector<size_t> &uses,
+            Fusion &fusion) const;
+  bool IsConstant(Node node) const {
+    return nodes_[node].kind == Kind::kConstant;
+  }
+  bool IsConstant(Node node, double value) const {
+    return IsConstant(node) && nodes_[node].value == value;
+  }
+  // Only the identities that keep the sign of zero are applied: x+0 is
+  // +0, not x, when x is -0.
+  bool IsZero(Node node, bool negative) const {
+    return IsConstant(node, 0) &&
+           std::signbit(nodes_[node].value) == negative;
+  }
+  bool IsOperation(Node node, OpCode code) const {
+    return nodes_[node].kind == Kind::kOperation && nodes_[node].code == code;
+  }
+  std::vector<Node> Schedule(Node root) const;
+  static double Fold(OpCode code, double lhs, double rhs,
+                     double addend = 0);
+};  // class Compiler
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_COMPILER_H_
@@ -0,0 +1,124 @@
+#include "dual.h"
+
+#include <cmath>
+
+namespace {
+
+constexpr double kLn10 = 2.30258509299404568402;
+
+// g(u) for an outer function g with g' = slope and g'' = curvature at u.
+s21::Dual Chain(const s21::Dual &u, double value, double slope,
+                double curvature) {
+  return {value, slope * u.first,
+          curvature * u.first * u.first + slope * u.second};
+}
+
+}  // namespace
+
+s21::Dual s21::dual::Neg(const Dual &x) {
+  return {-x.value, -x.first, -x.second};
+}
+
+s21::Dual s21::dual::Sqrt(const Dual &x) {
+  double root = std::sqrt(x.value);
+  double slope = 0.5 / root;
+  return Chain(x, root, slope, -slope / (2 * x.value));
+}
+
+s21::Dual s21::dual::Ln(const Dual &x) {
+  double inverse = 1 / x.value;
+  return Chain(x, std::log(x.value), inverse, -inverse * inverse);
+}
+
+s21::Dual s21::dual::Log10(const Dual &x) {
+  double inverse = 1 / (x.value * kLn10);
+  return Chain(x, std::log10(x.value), inverse, -inverse / x.value);
+}
+
+s21::Dual s21::dual::Sin(const Dual &x) {
+  double sin = std::sin(x.value);
+  return Chain(x, sin, std::cos(x.value), -sin);
+}
+
+s21::Dual s21::dual::Cos(const Dual &x) {
+  double cos = std::cos(x.value);
+  return Chain(x, cos, -std::sin(x.value), -cos);
+}
+
+s21::Dual s21::dual::Tan(const Dual &x) {
+  double tan = std::tan(x.value);
+  double slope = 1 + tan * tan;
+  return Chain(x, tan, slope, 2 * tan * slope);
+}
+
+s21::Dual s21::dual::ArcSin(const Dual &x) {
+  double slope = 1 / std::sqrt(1 - x.value * x.value);
+  return Chain(x, std::asin(x.value), slope,
+               x.value * slope * slope * slope);
+}
+
+s21::Dual s21::dual::ArcCos(const Dual &x) {
+  double slope = 1 / std::sqrt(1 - x.value * x.value);
+  return Chain(x, std::acos(x.value), -slope,
+               -x.value * slope * slope * slope);
+}
+
+s21::Dual s21::dual::ArcTan(const Dual &x) {
+  double slope = 1 / (1 + x.value * x.value);
+  return Chain(x, std::atan(x.value), slope, -2 * x.value * slope * slope);
+}
+
+s21::Dual s21::dual::Add(const Dual &lhs, const Dual &rhs) {
+  return {lhs.value + rhs.value, lhs.first + rhs.first,
+          lhs.second + rhs.second};
+}
+
+s21::Dual s21::dual::Sub(const Dual &lhs, const Dual &rhs) {
+  return {lhs.value - rhs.value, lhs.first - rhs.first,
+          lhs.second - rhs.second};
+}
+
+s21::Dual s21::dual::Mul(const Dual &lhs, const Dual &rhs) {
+  return {lhs.value * rhs.value,
+          lhs.first * rhs.value + lhs.value * rhs.first,
+          lhs.second * rhs.value + 2 * lhs.first * rhs.first +
+              lhs.value * rhs.second};
+}
+
+s21::Dual s21::dual::Div(const Dual &lhs, const Dual &rhs) {
+  double quotient = lhs.value / rhs.value;
+  double first = (lhs.first - quotient * rhs.first) / rhs.value;
+  return {quotient, first,
+          (lhs.second - 2 * first * rhs.first - quotient * rhs.second) /
+              rhs.value};
+}
+
+// fmod(a, b) is a - n * b with n = trunc(a / b), constant between the
+// jumps.
+s21::Dual s21::dual::Mod(const Dual &lhs, const Dual &rhs) {
+  double quotient = std::trunc(lhs.value / rhs.value);
+  return {std::fmod(lhs.value, rhs.value), lhs.first - quotient * rhs.first,
+          lhs.second - quotient * rhs.second};
+}
+
+s21::Dual s21::dual::Pow(const Dual &lhs, const Dual &rhs) {
+  if (rhs.first == 0 && rhs.second == 0) {
+    // The power rule also holds for negative bases and integer exponents.
+    double n = rhs.value;
+    double slope = n == 0 ? 0 : n * std::pow(lhs.value, n - 1);
+    double curvature =
+        n == 0 || n == 1 ? 0 : n * (n - 1) * std::pow(lhs.value, n - 2);
+    return Chain(lhs, std::pow(lhs.value, n), slope, curvature);
+  }
+  // a^b = exp(b * ln(a)).
+  Dual exponent = Mul(rhs, Ln(lhs));
+  double power = std::pow(lhs.value, rhs.value);
+  return Chain(exponent, power, power, power);
+}
+
+s21::Dual s21::dual::Fma(const Dual &lhs, const Dual &rhs,
+                         const Dual &addend) {
+  Dual sum = Add(Mul(lhs, rhs), addend);
+  sum.value = std::fma(lhs.value, rhs.value, addend.value);
+  return sum;
+}
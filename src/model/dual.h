@@ -0,0 +1,49 @@
+#ifndef SRC_MODEL_DUAL_H_
+#define SRC_MODEL_DUAL_H_
+
+#include <cstddef>
+
+namespace s21 {
+
+// Value of a function together with its first and second derivatives at
+// the same point. Running a program over Variable(x) applies the chain
+// rule at every instruction, so the result holds f(x), f'(x) and f''(x)
+// computed exactly rather than by finite differences.
+struct Dual {
+  double value;
+  double first;
+  double second;
+
+  static Dual Constant(double c) { return {c, 0, 0}; }
+  static Dual Variable(double x) { return {x, 1, 0}; }
+  double Derivative(size_t order) const {
+    return order == 0 ? value : order == 1 ? first : second;
+  }
+};  // struct Dual
+
+// Derivative rules of the opcodes.
+namespace dual {
+
+Dual Neg(const Dual &x);
+Dual Sqrt(const Dual &x);
+Dual Ln(const Dual &x);
+Dual Log10(const Dual &x);
+Dual Sin(const Dual &x);
+Dual Cos(const Dual &x);
+Dual Tan(const Dual &x);
+Dual ArcSin(const Dual &x);
+Dual ArcCos(const Dual &x);
+Dual ArcTan(const Dual &x);
+Dual Add(const Dual &lhs, const Dual &rhs);
+Dual Sub(const Dual &lhs, const Dual &rhs);
+Dual Mul(const Dual &lhs, const Dual &rhs);
+Dual Div(const Dual &lhs, const Dual &rhs);
+Dual Mod(const Dual &lhs, const Dual &rhs);
+Dual Pow(const Dual &lhs, const Dual &rhs);
+Dual Fma(const Dual &lhs, const Dual &rhs, const Dual &addend);
+
+}  // namespace dual
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_DUAL_H_
@@ -0,0 +1,323 @@
+#include "evaluator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void s21::Evaluator::Load(std::shared_ptr<const Program> program) {
+  program_ = std::move(program);
+  block_.clear();
+  intervals_.clear();
+  duals_.clear();
+  jit_.reset();
+  jit_resolved_ = false;
+  if (program_) {
+    registers_ = program_->GetRegisters();
+    Execute(program_->GetInvariantInstructions(), registers_.data());
+  } else {
+    registers_.clear();
+  }
+}
+
+double s21::Evaluator::Evaluate(double x) {
+  if (!program_ || !program_->IsValid()) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  double *r = registers_.data();
+  r[Program::kXRegister] = x;
+  if (const JitCode *jit = GetJit(1)) {
+    jit->Evaluate(r);
+  } else {
+    Execute(program_->GetInstructions(), r);
+  }
+  return r[program_->GetResult()];
+}
+
+void s21::Evaluator::SetParameter(size_t index, double value) {
+  registers_[program_->GetParameters()[index]] = value;
+  Execute(program_->GetInvariantInstructions(), registers_.data());
+  block_.clear();
+  intervals_.clear();
+  duals_.clear();
+}
+
+// The native code once the program has run for jit_threshold_ samples, and
+// null before that or when it cannot be generated. Samples are counted
+// per program, and the code is compiled only once for all evaluators.
+const s21::JitCode *s21::Evaluator::GetJit(size_t samples) {
+  if (jit_resolved_) {
+    return jit_.get();
+  }
+  Program::NativeCode &native = program_->GetNativeCode();
+  if (native.samples.fetch_add(samples) + samples < jit_threshold_) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(native.mutex);
+  if (!native.compiled) {
+    native.code = JitCode::Compile(*program_, *kernels_, kBlockSize);
+    native.compiled = true;
+  }
+  jit_ = native.code;
+  jit_resolved_ = true;
+  return jit_.get();
+}
+
+void s21::Evaluator::Execute(const std::vector<Instruction> &code,
+                             double *r) {
+  for (const Instruction &op : code) {
+    switch (op.code) {
+      case OpCode::kNeg:
+        r[op.dst] = -r[op.lhs];
+        break;
+      case OpCode::kSqrt:
+        r[op.dst] = std::sqrt(r[op.lhs]);
+        break;
+      case OpCode::kLn:
+        r[op.dst] = std::log(r[op.lhs]);
+        break;
+      case OpCode::kLog10:
+        r[op.dst] = std::log10(r[op.lhs]);
+        break;
+      case OpCode::kSin:
+        r[op.dst] = std::sin(r[op.lhs]);
+        break;
+      case OpCode::kCos:
+        r[op.dst] = std::cos(r[op.lhs]);
+        break;
+      case OpCode::kTan:
+        r[op.dst] = std::tan(r[op.lhs]);
+        break;
+      case OpCode::kArcSin:
+        r[op.dst] = std::asin(r[op.lhs]);
+        break;
+      case OpCode::kArcCos:
+        r[op.dst] = std::acos(r[op.lhs]);
+        break;
+      case OpCode::kArcTan:
+        r[op.dst] = std::atan(r[op.lhs]);
+        break;
+      case OpCode::kSinCos: {
+        double x = r[op.lhs];
+        r[op.dst] = std::sin(x);
+        r[op.rhs] = std::cos(x);
+        break;
+      }
+      case OpCode::kAdd:
+        r[op.dst] = r[op.lhs] + r[op.rhs];
+        break;
+      case OpCode::kSub:
+        r[op.dst] = r[op.lhs] - r[op.rhs];
+        break;
+      case OpCode::kMul:
+        r[op.dst] = r[op.lhs] * r[op.rhs];
+        break;
+      case OpCode::kDiv:
+        r[op.dst] = r[op.lhs] / r[op.rhs];
+        break;
+      case OpCode::kMod:
+        r[op.dst] = std::fmod(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kPow:
+        r[op.dst] = std::pow(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kFma:
+        r[op.dst] = std::fma(r[op.lhs], r[op.rhs], r[op.addend]);
+        break;
+    }
+  }
+}
+
+void s21::Evaluator::EvaluateBatch(const double *x, double *y, size_t count) {
+  if (!program_ || !program_->IsValid()) {
+    std::fill(y, y + count, std::numeric_limits<double>::quiet_NaN());
+    return;
+  }
+  if (block_.empty()) {
+    block_.resize(registers_.size() * kBlockSize);
+    for (Register reg = 0; reg < registers_.size(); ++reg) {
+      std::fill(Lane(reg), Lane(reg) + kBlockSize, registers_[reg]);
+    }
+  }
+  for (size_t offset = 0; offset < count; offset += kBlockSize) {
+    EvaluateBlock(x + offset, y + offset, std::min(kBlockSize, count - offset));
+  }
+}
+
+s21::Interval s21::Evaluator::EvaluateInterval(Interval x) {
+  if (!program_ || !program_->IsValid()) {
+    return Interval::Empty();
+  }
+  if (intervals_.empty()) {
+    for (double value : registers_) {
+      intervals_.push_back(Interval::Point(value));
+    }
+  }
+  Interval *r = intervals_.data();
+  r[Program::kXRegister] = x;
+  for (const Instruction &op : program_->GetInstructions()) {
+    switch (op.code) {
+      case OpCode::kNeg:
+        r[op.dst] = interval::Neg(r[op.lhs]);
+        break;
+      case OpCode::kSqrt:
+        r[op.dst] = interval::Sqrt(r[op.lhs]);
+        break;
+      case OpCode::kLn:
+        r[op.dst] = interval::Ln(r[op.lhs]);
+        break;
+      case OpCode::kLog10:
+        r[op.dst] = interval::Log10(r[op.lhs]);
+        break;
+      case OpCode::kSin:
+        r[op.dst] = interval::Sin(r[op.lhs]);
+        break;
+      case OpCode::kCos:
+        r[op.dst] = interval::Cos(r[op.lhs]);
+        break;
+      case OpCode::kTan:
+        r[op.dst] = interval::Tan(r[op.lhs]);
+        break;
+      case OpCode::kArcSin:
+        r[op.dst] = interval::ArcSin(r[op.lhs]);
+        break;
+      case OpCode::kArcCos:
+        r[op.dst] = interval::ArcCos(r[op.lhs]);
+        break;
+      case OpCode::kArcTan:
+        r[op.dst] = interval::ArcTan(r[op.lhs]);
+        break;
+      case OpCode::kSinCos: {
+        Interval angle = r[op.lhs];
+        r[op.dst] = interval::Sin(angle);
+        r[op.rhs] = interval::Cos(angle);
+        break;
+      }
+      case OpCode::kAdd:
+        r[op.dst] = interval::Add(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kSub:
+        r[op.dst] = interval::Sub(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kMul:
+        // x * x is never negative, which Mul cannot tell.
+        r[op.dst] = op.lhs == op.rhs
+                        ? interval::Pow(r[op.lhs], Interval::Point(2))
+                        : interval::Mul(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kDiv:
+        r[op.dst] = interval::Div(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kMod:
+        r[op.dst] = interval::Mod(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kPow:
+        r[op.dst] = interval::Pow(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kFma:
+        r[op.dst] = interval::Fma(r[op.lhs], r[op.rhs], r[op.addend]);
+        break;
+    }
+  }
+  return r[program_->GetResult()];
+}
+
+s21::Dual s21::Evaluator::EvaluateDual(double x) {
+  if (!program_ || !program_->IsValid()) {
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    return {nan, nan, nan};
+  }
+  if (duals_.empty()) {
+    for (double value : registers_) {
+      duals_.push_back(Dual::Constant(value));
+    }
+  }
+  Dual *r = duals_.data();
+  r[Program::kXRegister] = Dual::Variable(x);
+  for (const Instruction &op : program_->GetInstructions()) {
+    switch (op.code) {
+      case OpCode::kNeg:
+        r[op.dst] = dual::Neg(r[op.lhs]);
+        break;
+      case OpCode::kSqrt:
+        r[op.dst] = dual::Sqrt(r[op.lhs]);
+        break;
+      case OpCode::kLn:
+        r[op.dst] = dual::Ln(r[op.lhs]);
+        break;
+      case OpCode::kLog10:
+        r[op.dst] = dual::Log10(r[op.lhs]);
+        break;
+      case OpCode::kSin:
+        r[op.dst] = dual::Sin(r[op.lhs]);
+        break;
+      case OpCode::kCos:
+        r[op.dst] = dual::Cos(r[op.lhs]);
+        break;
+      case OpCode::kTan:
+        r[op.dst] = dual::Tan(r[op.lhs]);
+        break;
+      case OpCode::kArcSin:
+        r[op.dst] = dual::ArcSin(r[op.lhs]);
+        break;
+      case OpCode::kArcCos:
+        r[op.dst] = dual::ArcCos(r[op.lhs]);
+        break;
+      case OpCode::kArcTan:
+        r[op.dst] = dual::ArcTan(r[op.lhs]);
+        break;
+      case OpCode::kSinCos: {
+        Dual angle = r[op.lhs];
+        r[op.dst] = dual::Sin(angle);
+        r[op.rhs] = dual::Cos(angle);
+        break;
+      }
+      case OpCode::kAdd:
+        r[op.dst] = dual::Add(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kSub:
+        r[op.dst] = dual::Sub(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kMul:
+        r[op.dst] = dual::Mul(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kDiv:
+        r[op.dst] = dual::Div(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kMod:
+        r[op.dst] = dual::Mod(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kPow:
+        r[op.dst] = dual::Pow(r[op.lhs], r[op.rhs]);
+        break;
+      case OpCode::kFma:
+        r[op.dst] = dual::Fma(r[op.lhs], r[op.rhs], r[op.addend]);
+        break;
+    }
+  }
+  return r[program_->GetResult()];
+}
+
+void s21::Evaluator::EvaluateBlock(const double *x, double *y, size_t size) {
+  std::copy(x, x + size, Lane(Program::kXRegister));
+  const JitCode *jit = GetJit(size);
+  if (jit && jit->HasBlock()) {
+    jit->EvaluateBlock(block_.data());
+    const double *result = Lane(program_->GetResult());
+    std::copy(result, result + size, y);
+    return;
+  }
+  for (const Instruction &op : program_->GetInstructions()) {
+    if (op.code == OpCode::kSinCos) {
+      kernels_->GetSinCos()(Lane(op.dst), Lane(op.rhs), Lane(op.lhs),
+                            kBlockSize);
+    } else if (op.code == OpCode::kFma) {
+      kernels_->GetFma()(Lane(op.dst), Lane(op.lhs), Lane(op.rhs),
+                         Lane(op.addend), kBlockSize);
+    } else {
+      kernels_->Get(op.code)(Lane(op.dst), Lane(op.lhs), Lane(op.rhs),
+                             kBlockSize);
+    }
+  }
+  const double *result = Lane(program_->GetResult());
+  std::copy(result, result + size, y);
+}
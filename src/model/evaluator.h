@@ -0,0 +1,67 @@
+#ifndef SRC_MODEL_EVALUATOR_H_
+#define SRC_MODEL_EVALUATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "dual.h"
+#include "interval.h"
+#include "jit.h"
+#include "program.h"
+#include "simd_kernels.h"
+
+namespace s21 {
+
+// Owns a private copy of the register file of a program, so several
+// evaluators may run the same program concurrently. Batch evaluation keeps
+// a second register file in structure-of-arrays form: each register is a
+// block of kBlockSize lanes and every instruction is applied to the whole
+// block before the next one is dispatched, using the vectorized kernels of
+// simd_kernels.h. Interval evaluation runs the program over a whole range
+// of X at once and returns bounds enclosing every value f takes there, and
+// dual evaluation returns f'(x) and f''(x) along with f(x). Once scalar and
+// batch evaluation, summed over all evaluators of the program, have run
+// for the JIT threshold in samples, the program is compiled to native code
+// (see jit.h) that then replaces the interpreter for both where the
+// processor supports it. The code is kept with the program and shared.
+class Evaluator {
+ public:
+  static constexpr size_t kBlockSize = 256;
+
+  Evaluator() = default;
+  explicit Evaluator(std::shared_ptr<const Program> program) {
+    Load(std::move(program));
+  }
+
+  void Load(std::shared_ptr<const Program> program);
+  double Evaluate(double x);
+  // Changes a parameter of the program and reruns its invariant section.
+  void SetParameter(size_t index, double value);
+  void EvaluateBatch(const double *x, double *y, size_t count);
+  // Samples after which the program is compiled, DefaultJitThreshold()
+  // unless set here.
+  void SetJitThreshold(size_t samples) { jit_threshold_ = samples; }
+  bool IsCompiled() const { return jit_ != nullptr; }
+  Interval EvaluateInterval(Interval x);
+  Dual EvaluateDual(double x);
+
+ private:
+  std::shared_ptr<const Program> program_{};
+  std::vector<double> registers_{};
+  std::vector<double> block_{};
+  std::vector<Interval> intervals_{};
+  std::vector<Dual> duals_{};
+  const KernelSet *kernels_{&DefaultKernels()};
+  std::shared_ptr<const JitCode> jit_{};
+  bool jit_resolved_{};
+  size_t jit_threshold_{DefaultJitThreshold()};
+
+  const JitCode *GetJit(size_t samples);
+  static void Execute(const std::vector<Instruction> &code, double *r);
+  double *Lane(Register reg) { return block_.data() + reg * kBlockSize; }
+  void EvaluateBlock(const double *x, double *y, size_t size);
+};  // class Evaluator
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_EVALUATOR_H_
@@ -0,0 +1,154 @@
+#include "integral.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+
+#include "thread_pool.h"
+
+namespace {
+
+// Abscissae of the 15-point Kronrod rule on [-1, 1], from the end inwards;
+// the odd ones are the nodes of the embedded 7-point Gauss rule.
+constexpr double kKronrodNodes[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+constexpr double kKronrodWeights[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+constexpr double kGaussWeights[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+}  // namespace
+
+s21::Integral s21::Integrator::Integrate(double a, double b) const {
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  if (!program_ || !program_->IsValid() || std::isnan(a) || std::isnan(b)) {
+    return {nan, nan};
+  }
+  if (a == b) {
+    return {0, 0};
+  }
+  if (b < a) {
+    Integral reversed = Integrate(b, a);
+    return {-reversed.value, reversed.error};
+  }
+  std::vector<Segment> segments;
+  std::vector<size_t> changed;
+  double width = (b - a) / kInitialSegments;
+  for (size_t i = 0; i < kInitialSegments; ++i) {
+    double from = a + width * static_cast<double>(i);
+    double to = i + 1 == kInitialSegments ? b : from + width;
+    segments.push_back({from, to, 0, 0});
+    changed.push_back(i);
+  }
+  auto by_error = [](const Segment &lhs, const Segment &rhs) {
+    return lhs.error > rhs.error;
+  };
+  Integral total = {};
+  while (!changed.empty()) {
+    EstimateAll(segments, changed);
+    changed.clear();
+    total = {};
+    for (const Segment &segment : segments) {
+      total.value += segment.value;
+      total.error += segment.error;
+    }
+    double tolerance = std::max(kAbsoluteTolerance,
+                                kRelativeTolerance * std::fabs(total.value));
+    if (!(total.error > tolerance) || segments.size() >= kMaxSegments) {
+      break;
+    }
+    // Split the worst segments, but none whose share of the error is
+    // already below its share of the tolerance.
+    size_t splits = std::min(
+        {kSplitsPerRound, segments.size(), kMaxSegments - segments.size()});
+    std::partial_sort(segments.begin(), segments.begin() + splits,
+                      segments.end(), by_error);
+    double share = tolerance / static_cast<double>(segments.size());
+    for (size_t i = 0; i < splits && (i == 0 || segments[i].error > share);
+         ++i) {
+      double middle = segments[i].a + (segments[i].b - segments[i].a) / 2;
+      if (middle > segments[i].a && middle < segments[i].b) {
+        segments.push_back({middle, segments[i].b, 0, 0});
+        segments[i].b = middle;
+        changed.push_back(i);
+        changed.push_back(segments.size() - 1);
+      }
+    }
+  }
+  return total;
+}
+
+void s21::Integrator::EstimateAll(std::vector<Segment> &segments,
+                                  const std::vector<size_t> &indices) const {
+  ThreadPool &pool = ThreadPool::Shared();
+  size_t groups = std::min(indices.size(), pool.GetThreadCount());
+  std::vector<std::future<void>> estimated;
+  for (size_t group = 0; group < groups; ++group) {
+    estimated.push_back(pool.Submit([&, group]() {
+      Evaluator evaluator(program_);
+      std::vector<double> x(kNodes);
+      std::vector<double> y(kNodes);
+      for (size_t i = group; i < indices.size(); i += groups) {
+        Estimate(evaluator, x, y, segments[indices[i]]);
+      }
+    }));
+  }
+  for (std::future<void> &done : estimated) {
+    done.get();
+  }
+}
+
+// Error estimate of QUADPACK's qk15: the Gauss-Kronrod difference, scaled
+// down for smooth integrands and kept above the rounding error of the sum.
+void s21::Integrator::Estimate(Evaluator &evaluator, std::vector<double> &x,
+                               std::vector<double> &y, Segment &segment) {
+  double center = segment.a + (segment.b - segment.a) / 2;
+  double half = (segment.b - segment.a) / 2;
+  for (size_t i = 0; i < 7; ++i) {
+    x[2 * i] = center - half * kKronrodNodes[i];
+    x[2 * i + 1] = center + half * kKronrodNodes[i];
+  }
+  x[14] = center;
+  evaluator.EvaluateBatch(x.data(), y.data(), kNodes);
+
+  double kronrod = kKronrodWeights[7] * y[14];
+  double gauss = kGaussWeights[3] * y[14];
+  double absolute = std::fabs(kronrod);
+  for (size_t i = 0; i < 7; ++i) {
+    double sum = y[2 * i] + y[2 * i + 1];
+    kronrod += kKronrodWeights[i] * sum;
+    absolute += kKronrodWeights[i] *
+                (std::fabs(y[2 * i]) + std::fabs(y[2 * i + 1]));
+    if (i % 2 == 1) {
+      gauss += kGaussWeights[i / 2] * sum;
+    }
+  }
+  double mean = kronrod / 2;
+  double deviation = kKronrodWeights[7] * std::fabs(y[14] - mean);
+  for (size_t i = 0; i < 7; ++i) {
+    deviation += kKronrodWeights[i] *
+                 (std::fabs(y[2 * i] - mean) + std::fabs(y[2 * i + 1] - mean));
+  }
+  segment.value = kronrod * half;
+  double error = std::fabs((kronrod - gauss) * half);
+  deviation *= std::fabs(half);
+  absolute *= std::fabs(half);
+  if (deviation != 0 && error != 0) {
+    error = deviation * std::min(1.0, std::pow(200 * error / deviation, 1.5));
+  }
+  double epsilon = std::numeric_limits<double>::epsilon();
+  if (absolute > std::numeric_limits<double>::min() / (50 * epsilon)) {
+    error = std::max(50 * epsilon * absolute, error);
+  }
+  segment.error = std::isfinite(segment.value)
+                      ? error
+                      : std::numeric_limits<double>::infinity();
+}
@@ -0,0 +1,60 @@
+#ifndef SRC_MODEL_INTEGRAL_H_
+#define SRC_MODEL_INTEGRAL_H_
+
+#include <memory>
+#include <vector>
+
+#include "evaluator.h"
+#include "program.h"
+
+namespace s21 {
+
+struct Integral {
+  double value;
+  // Estimated absolute error of value.
+  double error;
+};
+
+// Definite integrals by globally adaptive 15-point Gauss-Kronrod
+// quadrature. The range starts as kInitialSegments equal segments; each
+// round then bisects up to kSplitsPerRound segments with the largest error
+// estimates, until the total error is within the tolerance or there are
+// kMaxSegments segments. The nodes of a segment are evaluated in one batch
+// and the new segments of a round are estimated in parallel on the shared
+// thread pool, split into one group per worker. The rounds do not depend
+// on timing, so the result is the same on every run.
+class Integrator {
+ public:
+  static constexpr double kRelativeTolerance = 1e-10;
+  static constexpr double kAbsoluteTolerance = 1e-12;
+  static constexpr size_t kInitialSegments = 16;
+  static constexpr size_t kSplitsPerRound = 32;
+  static constexpr size_t kMaxSegments = 4096;
+
+  explicit Integrator(std::shared_ptr<const Program> program)
+      : program_(std::move(program)) {}
+
+  // Integral of the program from a to b, negated when b < a.
+  Integral Integrate(double a, double b) const;
+
+ private:
+  struct Segment {
+    double a;
+    double b;
+    double value;
+    double error;
+  };
+
+  static constexpr size_t kNodes = 15;
+
+  void EstimateAll(std::vector<Segment> &segments,
+                   const std::vector<size_t> &indices) const;
+  static void Estimate(Evaluator &evaluator, std::vector<double> &x,
+                       std::vector<double> &y, Segment &segment);
+
+  std::shared_ptr<const Program> program_{};
+};  // class Integrator
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_INTEGRAL_H_
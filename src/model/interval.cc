@@ -0,0 +1,247 @@
+#include "interval.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+constexpr double kPi = 3.14159265358979323846;
+
+// Rounds the bounds outwards. A NaN bound can only come from inf - inf or
+// 0 * inf on non-empty arguments, so nothing is known about the result.
+s21::Interval Widen(double lo, double hi) {
+  if (std::isnan(lo) || std::isnan(hi)) {
+    return s21::Interval::Entire();
+  }
+  return {std::nextafter(lo, -kInf), std::nextafter(hi, kInf)};
+}
+
+// Whether offset + k * period lies in x for some integer k.
+bool ContainsPeriodic(s21::Interval x, double offset, double period) {
+  return std::floor((x.hi - offset) / period) >=
+         std::ceil((x.lo - offset) / period);
+}
+
+bool IsFinite(s21::Interval x) {
+  return std::isfinite(x.lo) && std::isfinite(x.hi);
+}
+
+s21::Interval Clamp(s21::Interval x, double lo, double hi) {
+  return {std::max(x.lo, lo), std::min(x.hi, hi)};
+}
+
+}  // namespace
+
+s21::Interval s21::interval::Neg(Interval x) { return {-x.hi, -x.lo}; }
+
+s21::Interval s21::interval::Sqrt(Interval x) {
+  if (x.IsEmpty() || x.hi < 0) {
+    return Interval::Empty();
+  }
+  Interval result = Widen(std::sqrt(std::max(x.lo, 0.0)), std::sqrt(x.hi));
+  return Clamp(result, 0, kInf);
+}
+
+s21::Interval s21::interval::Ln(Interval x) {
+  if (x.IsEmpty() || x.hi < 0) {
+    return Interval::Empty();
+  }
+  return Widen(std::log(std::max(x.lo, 0.0)), std::log(x.hi));
+}
+
+s21::Interval s21::interval::Log10(Interval x) {
+  if (x.IsEmpty() || x.hi < 0) {
+    return Interval::Empty();
+  }
+  return Widen(std::log10(std::max(x.lo, 0.0)), std::log10(x.hi));
+}
+
+s21::Interval s21::interval::Sin(Interval x) {
+  if (x.IsEmpty()) {
+    return x;
+  }
+  if (!IsFinite(x) || x.hi - x.lo >= 2 * kPi) {
+    return {-1, 1};
+  }
+  double lo = std::min(std::sin(x.lo), std::sin(x.hi));
+  double hi = std::max(std::sin(x.lo), std::sin(x.hi));
+  if (ContainsPeriodic(x, kPi / 2, 2 * kPi)) {
+    hi = 1;
+  }
+  if (ContainsPeriodic(x, -kPi / 2, 2 * kPi)) {
+    lo = -1;
+  }
+  return Clamp(Widen(lo, hi), -1, 1);
+}
+
+s21::Interval s21::interval::Cos(Interval x) {
+  if (x.IsEmpty()) {
+    return x;
+  }
+  if (!IsFinite(x) || x.hi - x.lo >= 2 * kPi) {
+    return {-1, 1};
+  }
+  double lo = std::min(std::cos(x.lo), std::cos(x.hi));
+  double hi = std::max(std::cos(x.lo), std::cos(x.hi));
+  if (ContainsPeriodic(x, 0, 2 * kPi)) {
+    hi = 1;
+  }
+  if (ContainsPeriodic(x, kPi, 2 * kPi)) {
+    lo = -1;
+  }
+  return Clamp(Widen(lo, hi), -1, 1);
+}
+
+s21::Interval s21::interval::Tan(Interval x) {
+  if (x.IsEmpty()) {
+    return x;
+  }
+  if (!IsFinite(x) || x.hi - x.lo >= kPi ||
+      ContainsPeriodic(x, kPi / 2, kPi)) {
+    return Interval::Entire();
+  }
+  return Widen(std::tan(x.lo), std::tan(x.hi));
+}
+
+s21::Interval s21::interval::ArcSin(Interval x) {
+  if (x.IsEmpty() || x.hi < -1 || x.lo > 1) {
+    return Interval::Empty();
+  }
+  x = Clamp(x, -1, 1);
+  return Widen(std::asin(x.lo), std::asin(x.hi));
+}
+
+s21::Interval s21::interval::ArcCos(Interval x) {
+  if (x.IsEmpty() || x.hi < -1 || x.lo > 1) {
+    return Interval::Empty();
+  }
+  x = Clamp(x, -1, 1);
+  return Widen(std::acos(x.hi), std::acos(x.lo));
+}
+
+s21::Interval s21::interval::ArcTan(Interval x) {
+  if (x.IsEmpty()) {
+    return x;
+  }
+  return Widen(std::atan(x.lo), std::atan(x.hi));
+}
+
+s21::Interval s21::interval::Add(Interval lhs, Interval rhs) {
+  if (lhs.IsEmpty() || rhs.IsEmpty()) {
+    return Interval::Empty();
+  }
+  return Widen(lhs.lo + rhs.lo, lhs.hi + rhs.hi);
+}
+
+s21::Interval s21::interval::Sub(Interval lhs, Interval rhs) {
+  if (lhs.IsEmpty() || rhs.IsEmpty()) {
+    return Interval::Empty();
+  }
+  return Widen(lhs.lo - rhs.hi, lhs.hi - rhs.lo);
+}
+
+s21::Interval s21::interval::Mul(Interval lhs, Interval rhs) {
+  if (lhs.IsEmpty() || rhs.IsEmpty()) {
+    return Interval::Empty();
+  }
+  double products[] = {lhs.lo * rhs.lo, lhs.lo * rhs.hi, lhs.hi * rhs.lo,
+                       lhs.hi * rhs.hi};
+  for (double &product : products) {
+    // 0 * inf: one factor is exactly zero, so the product is too.
+    if (std::isnan(product)) {
+      product = 0;
+    }
+  }
+  return Widen(*std::min_element(std::begin(products), std::end(products)),
+               *std::max_element(std::begin(products), std::end(products)));
+}
+
+s21::Interval s21::interval::Div(Interval lhs, Interval rhs) {
+  if (lhs.IsEmpty() || rhs.IsEmpty() || (rhs.lo == 0 && rhs.hi == 0)) {
+    return Interval::Empty();
+  }
+  if (rhs.Contains(0)) {
+    return Interval::Entire();
+  }
+  return Mul(lhs, Widen(1 / rhs.hi, 1 / rhs.lo));
+}
+
+s21::Interval s21::interval::Mod(Interval lhs, Interval rhs) {
+  if (lhs.IsEmpty() || rhs.IsEmpty() || (rhs.lo == 0 && rhs.hi == 0)) {
+    return Interval::Empty();
+  }
+  double modulus = std::max(std::fabs(rhs.lo), std::fabs(rhs.hi));
+  if (rhs.lo == rhs.hi && IsFinite(lhs)) {
+    // fmod is lhs - n * rhs, increasing while the truncated quotient n
+    // stays the same. The rounded quotients can miss a multiple of the
+    // modulus next to lhs.lo, which leaves the remainders out of order.
+    double first = std::trunc(lhs.lo / modulus);
+    double last = std::trunc(lhs.hi / modulus);
+    if (first == last && (lhs.lo >= 0 || lhs.hi <= 0) &&
+        lhs.hi - lhs.lo < modulus) {
+      double lo = std::fmod(lhs.lo, rhs.lo);
+      double hi = std::fmod(lhs.hi, rhs.lo);
+      if (lo <= hi) {
+        return Widen(lo, hi);
+      }
+    }
+  }
+  // The remainder takes the sign of lhs and is smaller than both.
+  return {lhs.lo < 0 ? -std::min(-lhs.lo, modulus) : 0,
+          lhs.hi > 0 ? std::min(lhs.hi, modulus) : 0};
+}
+
+s21::Interval s21::interval::Pow(Interval lhs, Interval rhs) {
+  if (lhs.IsEmpty() || rhs.IsEmpty()) {
+    return Interval::Empty();
+  }
+  if (rhs.lo == rhs.hi && std::isfinite(rhs.lo) &&
+      std::floor(rhs.lo) == rhs.lo) {
+    double n = rhs.lo;
+    if (n == 0) {
+      return {1, 1};
+    }
+    double lo = std::pow(lhs.lo, n);
+    double hi = std::pow(lhs.hi, n);
+    bool odd = std::fmod(n, 2) != 0;
+    // x^n is monotone on either side of zero.
+    if (lhs.lo >= 0 || lhs.hi <= 0 || (n > 0 && odd)) {
+      return Widen(std::min(lo, hi), std::max(lo, hi));
+    }
+    if (odd) {
+      return Interval::Entire();
+    }
+    if (n > 0) {
+      return {0, Widen(0, std::max(lo, hi)).hi};
+    }
+    return {Widen(std::min(lo, hi), 0).lo, kInf};
+  }
+  // A negative base has real powers only at integer exponents.
+  bool integer_exponent = std::floor(rhs.hi) >= std::ceil(rhs.lo);
+  if (lhs.lo < 0 && integer_exponent) {
+    return Interval::Entire();
+  }
+  if (lhs.hi < 0) {
+    return Interval::Empty();
+  }
+  // With a positive base the power is exp(rhs * ln(lhs)), whose extremes
+  // over the box lie at its corners.
+  double base_lo = std::max(lhs.lo, 0.0);
+  double corners[] = {std::pow(base_lo, rhs.lo), std::pow(base_lo, rhs.hi),
+                      std::pow(lhs.hi, rhs.lo), std::pow(lhs.hi, rhs.hi)};
+  for (double corner : corners) {
+    if (std::isnan(corner)) {
+      return Interval::Entire();
+    }
+  }
+  return Widen(*std::min_element(std::begin(corners), std::end(corners)),
+               *std::max_element(std::begin(corners), std::end(corners)));
+}
+
+// The fused result is the exact lhs * rhs + addend rounded once, and the
+// outward rounded bounds of the exact value enclose it.
+s21::Interval s21::interval::Fma(Interval lhs, Interval rhs,
+                                 Interval addend) {
+  return Add(Mul(lhs, rhs), addend);
+}
@@ -0,0 +1,57 @@
+#ifndef SRC_MODEL_INTERVAL_H_
+#define SRC_MODEL_INTERVAL_H_
+
+#include <cmath>
+#include <limits>
+
+namespace s21 {
+
+// Closed range of reals [lo, hi]. Both bounds are NaN for the empty
+// interval, which is what an operation returns when none of its arguments
+// lie in its domain.
+struct Interval {
+  double lo;
+  double hi;
+
+  static Interval Point(double x) { return {x, x}; }
+  static Interval Empty() {
+    return {std::numeric_limits<double>::quiet_NaN(),
+            std::numeric_limits<double>::quiet_NaN()};
+  }
+  static Interval Entire() {
+    return {-std::numeric_limits<double>::infinity(),
+            std::numeric_limits<double>::infinity()};
+  }
+  bool IsEmpty() const { return std::isnan(lo) || std::isnan(hi); }
+  bool Contains(double x) const { return lo <= x && x <= hi; }
+};  // struct Interval
+
+// Interval extensions of the opcodes. The result of each one encloses
+// every value the operation takes on the points of its arguments where it
+// is defined; the bounds are widened by one ulp to absorb the rounding of
+// the scalar functions.
+namespace interval {
+
+Interval Neg(Interval x);
+Interval Sqrt(Interval x);
+Interval Ln(Interval x);
+Interval Log10(Interval x);
+Interval Sin(Interval x);
+Interval Cos(Interval x);
+Interval Tan(Interval x);
+Interval ArcSin(Interval x);
+Interval ArcCos(Interval x);
+Interval ArcTan(Interval x);
+Interval Add(Interval lhs, Interval rhs);
+Interval Sub(Interval lhs, Interval rhs);
+Interval Mul(Interval lhs, Interval rhs);
+Interval Div(Interval lhs, Interval rhs);
+Interval Mod(Interval lhs, Interval rhs);
+Interval Pow(Interval lhs, Interval rhs);
+Interval Fma(Interval lhs, Interval rhs, Interval addend);
+
+}  // namespace interval
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_INTERVAL_H_
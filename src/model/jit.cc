@@ -0,0 +1,414 @@
+#include "jit.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__unix__) || defined(__APPLE__))
+#define S21_JIT_X86 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#if defined(S21_JIT_X86)
+
+// Register numbers in the instruction encoding. rbx holds the register
+// file for the whole function and rax the lane offset inside a loop.
+enum Gpr : uint8_t { kRax = 0, kRcx = 1, kRdx = 2, kRbx = 3, kRsi = 6,
+                     kRdi = 7 };
+
+// The functions called by the scalar code, identical to the interpreter's.
+double Ln(double x) { return std::log(x); }
+double Log10(double x) { return std::log10(x); }
+double Sin(double x) { return std::sin(x); }
+double Cos(double x) { return std::cos(x); }
+double Tan(double x) { return std::tan(x); }
+double ArcSin(double x) { return std::asin(x); }
+double ArcCos(double x) { return std::acos(x); }
+double ArcTan(double x) { return std::atan(x); }
+double Mod(double lhs, double rhs) { return std::fmod(lhs, rhs); }
+double Pow(double lhs, double rhs) { return std::pow(lhs, rhs); }
+double Fma(double lhs, double rhs, double addend) {
+  return std::fma(lhs, rhs, addend);
+}
+void SinCos(double x, double *sin, double *cos) {
+  *sin = std::sin(x);
+  *cos = std::cos(x);
+}
+
+class Assembler {
+ public:
+  const std::vector<uint8_t> &GetCode() const { return code_; }
+  size_t GetSize() const { return code_.size(); }
+
+  void Emit(std::initializer_list<uint8_t> bytes) {
+    code_.insert(code_.end(), bytes);
+  }
+  void Emit32(uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      code_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+  void Emit64(uint64_t value) {
+    Emit32(static_cast<uint32_t>(value));
+    Emit32(static_cast<uint32_t>(value >> 32));
+  }
+  void Align(size_t alignment) {
+    while (code_.size() % alignment != 0) {
+      Emit({0xcc});
+    }
+  }
+
+  // push rbx; mov rbx, rdi
+  void Prologue() { Emit({0x53, 0x48, 0x89, 0xfb}); }
+  // pop rbx; ret
+  void Epilogue() { Emit({0x5b, 0xc3}); }
+
+  // movsd, addsd and the like between xmm and [rbx + disp].
+  void Sse(uint8_t opcode, uint8_t xmm, int32_t disp) {
+    Emit({0xf2, 0x0f, opcode});
+    Memory(xmm, disp, false);
+  }
+  // Flips the sign bit of [rbx + disp] into [rbx + dst] through rax.
+  void NegateScalar(int32_t dst, int32_t disp) {
+    Emit({0x48, 0x8b});
+    Memory(kRax, disp, false);
+    Emit({0x48, 0x0f, 0xba, 0xf8, 0x3f});
+    Emit({0x48, 0x89});
+    Memory(kRax, dst, false);
+  }
+  // lea reg, [rbx + disp]
+  void Lea(Gpr reg, int32_t disp) {
+    Emit({0x48, 0x8d});
+    Memory(reg, disp, false);
+  }
+  void Call(uintptr_t function) {
+    Emit({0x48, 0xb8});
+    Emit64(function);
+    Emit({0xff, 0xd0});
+  }
+
+  // AVX instructions of the 66 0F map on ymm registers, with the memory
+  // operand [rbx + rax + disp]. source is the extra vvvv operand of
+  // three-operand forms.
+  void Avx(uint8_t opcode, uint8_t ymm, uint8_t source, int32_t disp) {
+    Emit({0xc5, static_cast<uint8_t>(0x85 | (~source & 0xf) << 3), opcode});
+    Memory(ymm, disp, true);
+  }
+  // vfmadd231pd ymm0, ymm1, [rbx + rax + disp]
+  void FmaVector(int32_t disp) {
+    Emit({0xc4, 0xe2, 0xf5, 0xb8});
+    Memory(0, disp, true);
+  }
+  // ymm7 = the sign bit in every lane, by vpcmpeqd and vpsllq.
+  void SignMask() { Emit({0xc5, 0xc5, 0x76, 0xff, 0xc5, 0xc5, 0x73, 0xf7,
+                         0x3f}); }
+  void ZeroUpper() { Emit({0xc5, 0xf8, 0x77}); }
+
+  // xor eax, eax; the loop body follows.
+  size_t LoopStart() {
+    Emit({0x31, 0xc0});
+    return code_.size();
+  }
+  // add rax, step; cmp rax, end; jb start
+  void LoopEnd(size_t start, uint8_t step, uint32_t end) {
+    Emit({0x48, 0x83, 0xc0, step, 0x48, 0x3d});
+    Emit32(end);
+    Emit({0x0f, 0x82});
+    Emit32(static_cast<uint32_t>(start - (code_.size() + 4)));
+  }
+  // mov ecx, value
+  void LoadCount(uint32_t value) {
+    Emit({0xb9});
+    Emit32(value);
+  }
+
+ private:
+  std::vector<uint8_t> code_{};
+
+  // ModRM byte, with a SIB byte when indexed, for [rbx + disp32] or
+  // [rbx + rax + disp32].
+  void Memory(uint8_t reg, int32_t disp, bool indexed) {
+    if (indexed) {
+      Emit({static_cast<uint8_t>(0x84 | reg << 3), 0x03});
+    } else {
+      Emit({static_cast<uint8_t>(0x80 | reg << 3 | kRbx)});
+    }
+    Emit32(static_cast<uint32_t>(disp));
+  }
+};  // class Assembler
+
+template <typename Function>
+uintptr_t Address(Function function) {
+  return reinterpret_cast<uintptr_t>(function);
+}
+
+int32_t Offset(s21::Register reg, size_t stride) {
+  return static_cast<int32_t>(reg * stride);
+}
+
+void EmitScalar(const std::vector<s21::Instruction> &code, Assembler &as) {
+  using s21::OpCode;
+  auto at = [](s21::Register reg) { return Offset(reg, sizeof(double)); };
+  as.Prologue();
+  for (const s21::Instruction &op : code) {
+    uintptr_t unary = 0;
+    uintptr_t binary = 0;
+    switch (op.code) {
+      case OpCode::kNeg:
+        as.NegateScalar(at(op.dst), at(op.lhs));
+        continue;
+      case OpCode::kSqrt:
+        as.Sse(0x51, 0, at(op.lhs));
+        as.Sse(0x11, 0, at(op.dst));
+        continue;
+      case OpCode::kAdd:
+      case OpCode::kSub:
+      case OpCode::kMul:
+      case OpCode::kDiv: {
+        const uint8_t opcodes[] = {0x58, 0x5c, 0x59, 0x5e};
+        as.Sse(0x10, 0, at(op.lhs));
+        as.Sse(opcodes[static_cast<int>(op.code) -
+                       static_cast<int>(OpCode::kAdd)],
+               0, at(op.rhs));
+        as.Sse(0x11, 0, at(op.dst));
+        continue;
+      }
+      case OpCode::kSinCos:
+        as.Sse(0x10, 0, at(op.lhs));
+        as.Lea(kRdi, at(op.dst));
+        as.Lea(kRsi, at(op.rhs));
+        as.Call(Address(SinCos));
+        continue;
+      case OpCode::kFma:
+        as.Sse(0x10, 0, at(op.lhs));
+        as.Sse(0x10, 1, at(op.rhs));
+        as.Sse(0x10, 2, at(op.addend));
+        as.Call(Address(Fma));
+        as.Sse(0x11, 0, at(op.dst));
+        continue;
+      case OpCode::kLn:
+        unary = Address(Ln);
+        break;
+      case OpCode::kLog10:
+        unary = Address(Log10);
+        break;
+      case OpCode::kSin:
+        unary = Address(Sin);
+        break;
+      case OpCode::kCos:
+        unary = Address(Cos);
+        break;
+      case OpCode::kTan:
+        unary = Address(Tan);
+        break;
+      case OpCode::kArcSin:
+        unary = Address(ArcSin);
+        break;
+      case OpCode::kArcCos:
+        unary = Address(ArcCos);
+        break;
+      case OpCode::kArcTan:
+        unary = Address(ArcTan);
+        break;
+      case OpCode::kMod:
+        binary = Address(Mod);
+        break;
+      case OpCode::kPow:
+        binary = Address(Pow);
+        break;
+    }
+    as.Sse(0x10, 0, at(op.lhs));
+    if (binary) {
+      as.Sse(0x10, 1, at(op.rhs));
+    }
+    as.Call(unary ? unary : binary);
+    as.Sse(0x11, 0, at(op.dst));
+  }
+  as.Epilogue();
+}
+
+bool IsInline(s21::OpCode code) {
+  switch (code) {
+    case s21::OpCode::kNeg:
+    case s21::OpCode::kSqrt:
+    case s21::OpCode::kAdd:
+    case s21::OpCode::kSub:
+    case s21::OpCode::kMul:
+    case s21::OpCode::kDiv:
+    case s21::OpCode::kFma:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// One pass of the lane loop over the inline instructions [begin, end).
+void EmitLoop(const std::vector<s21::Instruction> &code, size_t begin,
+              size_t end, size_t block_size, Assembler &as) {
+  using s21::OpCode;
+  size_t stride = block_size * sizeof(double);
+  auto at = [stride](s21::Register reg) { return Offset(reg, stride); };
+  for (size_t i = begin; i < end; ++i) {
+    if (code[i].code == OpCode::kNeg) {
+      as.SignMask();
+      break;
+    }
+  }
+  size_t start = as.LoopStart();
+  for (size_t i = begin; i < end; ++i) {
+    const s21::Instruction &op = code[i];
+    switch (op.code) {
+      case OpCode::kNeg:
+        as.Avx(0x57, 0, 7, at(op.lhs));
+        break;
+      case OpCode::kSqrt:
+        as.Avx(0x51, 0, 0, at(op.lhs));
+        break;
+      case OpCode::kFma:
+        as.Avx(0x10, 0, 0, at(op.addend));
+        as.Avx(0x10, 1, 0, at(op.lhs));
+        as.FmaVector(at(op.rhs));
+        break;
+      default: {
+        const uint8_t opcodes[] = {0x58, 0x5c, 0x59, 0x5e};
+        as.Avx(0x10, 0, 0, at(op.lhs));
+        as.Avx(opcodes[static_cast<int>(op.code) -
+                       static_cast<int>(OpCode::kAdd)],
+               0, 0, at(op.rhs));
+        break;
+      }
+    }
+    as.Avx(0x11, 0, 0, at(op.dst));
+  }
+  as.LoopEnd(start, 32, static_cast<uint32_t>(stride));
+}
+
+void EmitBlock(const std::vector<s21::Instruction> &code,
+               const s21::KernelSet &kernels, size_t block_size,
+               Assembler &as) {
+  size_t stride = block_size * sizeof(double);
+  auto at = [stride](s21::Register reg) { return Offset(reg, stride); };
+  as.Prologue();
+  for (size_t i = 0; i < code.size();) {
+    if (IsInline(code[i].code)) {
+      size_t end = i;
+      while (end < code.size() && IsInline(code[end].code)) {
+        ++end;
+      }
+      EmitLoop(code, i, end, block_size, as);
+      i = end;
+      continue;
+    }
+    const s21::Instruction &op = code[i++];
+    as.ZeroUpper();
+    as.LoadCount(static_cast<uint32_t>(block_size));
+    if (op.code == s21::OpCode::kSinCos) {
+      as.Lea(kRdi, at(op.dst));
+      as.Lea(kRsi, at(op.rhs));
+      as.Lea(kRdx, at(op.lhs));
+      as.Call(Address(kernels.GetSinCos()));
+    } else {
+      as.Lea(kRdi, at(op.dst));
+      as.Lea(kRsi, at(op.lhs));
+      as.Lea(kRdx, at(op.rhs));
+      as.Call(Address(kernels.Get(op.code)));
+    }
+  }
+  as.ZeroUpper();
+  as.Epilogue();
+}
+
+bool FitsDisplacement(const s21::Program &program, size_t stride) {
+  return program.GetRegisters().size() <=
+         static_cast<size_t>(std::numeric_limits<int32_t>::max()) / stride;
+}
+
+// The inline loops use AVX2 and FMA, so they are only generated along
+// with one of the tables that do, which also honours SMARTCALC_SIMD.
+bool SupportsBlock(const s21::KernelSet &kernels) {
+  if (std::strcmp(kernels.GetName(), "avx2") != 0 &&
+      std::strcmp(kernels.GetName(), "avx512") != 0) {
+    return false;
+  }
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+#endif  // S21_JIT_X86
+
+}  // namespace
+
+std::unique_ptr<s21::JitCode> s21::JitCode::Compile(const Program &program,
+                                                    const KernelSet &kernels,
+                                                    size_t block_size) {
+#if defined(S21_JIT_X86)
+  if (!program.IsValid() || !FitsDisplacement(program, sizeof(double))) {
+    return nullptr;
+  }
+  Assembler as;
+  EmitScalar(program.GetInstructions(), as);
+  size_t block_offset = 0;
+  bool block = SupportsBlock(kernels) && block_size % 4 == 0 &&
+               FitsDisplacement(program, block_size * sizeof(double));
+  if (block) {
+    as.Align(16);
+    block_offset = as.GetSize();
+    EmitBlock(program.GetInstructions(), kernels, block_size, as);
+  }
+
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t size = (as.GetSize() + page - 1) / page * page;
+  void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+  std::memcpy(memory, as.GetCode().data(), as.GetSize());
+  if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory, size);
+    return nullptr;
+  }
+  std::unique_ptr<JitCode> jit(new JitCode());
+  jit->memory_ = memory;
+  jit->size_ = size;
+  jit->scalar_ = reinterpret_cast<Function>(memory);
+  if (block) {
+    jit->block_ =
+        reinterpret_cast<Function>(static_cast<char *>(memory) + block_offset);
+  }
+  return jit;
+#else
+  (void)program;
+  (void)kernels;
+  (void)block_size;
+  return nullptr;
+#endif
+}
+
+s21::JitCode::~JitCode() {
+#if defined(S21_JIT_X86)
+  munmap(memory_, size_);
+#endif
+}
+
+size_t s21::DefaultJitThreshold() {
+  static const size_t threshold = [] {
+    const char *mode = std::getenv(kJitEnv);
+    if (mode && std::strcmp(mode, "off") == 0) {
+      return std::numeric_limits<size_t>::max();
+    }
+    if (mode && std::strcmp(mode, "always") == 0) {
+      return size_t{1};
+    }
+    return kJitThreshold;
+  }();
+  return threshold;
+}
@@ -0,0 +1,59 @@
+#ifndef SRC_MODEL_JIT_H_
+#define SRC_MODEL_JIT_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "program.h"
+#include "simd_kernels.h"
+
+namespace s21 {
+
+// Native x86-64 code for the per-sample instructions of a program, written
+// straight into an executable buffer of its own. The scalar function runs
+// them over a register file like Evaluator::Execute: arithmetic is done
+// inline with SSE2 and everything else calls the same libm functions as
+// the interpreter. The block function, generated only along with the avx2
+// or avx512 kernel table, runs them over a block register file: each run of
+// consecutive arithmetic instructions becomes one loop over the lanes,
+// four at a time, and the other instructions call the block kernels on the
+// whole block. Both give the same bits as the interpreter.
+class JitCode {
+ public:
+  using Function = void (*)(double *registers);
+
+  // Null where native code cannot be generated, on other architectures or
+  // when the system refuses to map executable memory.
+  static std::unique_ptr<JitCode> Compile(const Program &program,
+                                          const KernelSet &kernels,
+                                          size_t block_size);
+
+  JitCode(const JitCode &) = delete;
+  JitCode &operator=(const JitCode &) = delete;
+  ~JitCode();
+
+  void Evaluate(double *registers) const { scalar_(registers); }
+  bool HasBlock() const { return block_ != nullptr; }
+  void EvaluateBlock(double *block) const { block_(block); }
+
+ private:
+  JitCode() = default;
+
+  void *memory_{};
+  size_t size_{};
+  Function scalar_{};
+  Function block_{};
+};  // class JitCode
+
+// A program is compiled once its evaluators have together run it for
+// kJitThreshold samples. The environment variable kJitEnv changes that:
+// SMARTCALC_JIT=off keeps the interpreter and SMARTCALC_JIT=always
+// compiles on the first sample.
+constexpr const char *kJitEnv = "SMARTCALC_JIT";
+constexpr size_t kJitThreshold = 4096;
+
+size_t DefaultJitThreshold();
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_JIT_H_
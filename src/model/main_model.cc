@@ -8,15 +8,15 @@ s21::CalculatorModel::CalculatorModel() {
   InitFunctions();
   InitOperators();
   InitPriorities();
+  InitOpCodes();
 }
 
 void s21::CalculatorModel::InitFunctions() {
-  functions_ = {{"X", Lexem::kVariableX}, {"-", Lexem::kUnaryMinus},
-                {"sin", Lexem::kSin},     {"cos", Lexem::kCos},
+  functions_ = {{"sin", Lexem::kSin},     {"cos", Lexem::kCos},
                 {"tan", Lexem::kTan},     {"asin", Lexem::kArcSin},
                 {"acos", Lexem::kArcCos}, {"atan", Lexem::kArcTan},
-                {"sqrt", Lexem::kSqrt},   {"log", Lexem::kLog},
-                {"log10", Lexem::kLog10}};
+                {"sqrt", Lexem::kSqrt},   {"ln", Lexem::kLog},
+                {"log", Lexem::kLog10}};
 }
 
 void s21::CalculatorModel::InitOperators() {
@@ -34,11 +34,22 @@ void s21::CalculatorModel::InitPriorities() {
       {Lexem::kSub, 4}};
 }
 
+void s21::CalculatorModel::InitOpCodes() {
+  opcodes_ = {
+      {Lexem::kSin, OpCode::kSin},       {Lexem::kCos, OpCode::kCos},
+      {Lexem::kTan, OpCode::kTan},       {Lexem::kArcSin, OpCode::kArcSin},
+      {Lexem::kArcCos, OpCode::kArcCos}, {Lexem::kArcTan, OpCode::kArcTan},
+      {Lexem::kSqrt, OpCode::kSqrt},     {Lexem::kLog, OpCode::kLn},
+      {Lexem::kLog10, OpCode::kLog10},   {Lexem::kUnaryMinus, OpCode::kNeg},
+      {Lexem::kDeg, OpCode::kPow},       {Lexem::kMul, OpCode::kMul},
+      {Lexem::kDiv, OpCode::kDiv},       {Lexem::kMod, OpCode::kMod},
+      {Lexem::kSum, OpCode::kAdd},       {Lexem::kSub, OpCode::kSub}};
+}
+
 void s21::CalculatorModel::Calculate(const std::string &expression) {
-  SetExpression(expression);
+  LoadProgram(expression);
   try {
-    if (IsExpressionValid()) {
-      ConvertExpressionToPostfix();
+    if (program_->IsValid()) {
       CalculateExpression();
       ConvertResultToString();
     } else {
@@ -49,41 +60,60 @@ void s21::CalculatorModel::Calculate(const std::string &expression) {
   }
 }
 
-bool s21::CalculatorModel::IsExpressionValid() {
-  bool valid = false;
-  exprtk::symbol_table<double> symbol_table;
-  exprtk::expression<double> expression;
-  exprtk::parser<double> parser;
-  symbol_table.add_constants();
-  symbol_table.add_variable("X", x_value_);
-  expression.register_symbol_table(symbol_table);
-  SubstituteExpression();  // "log" -> "log10", "ln" -> "log",
-  // "mod" -> "%", "E" -> "*10^"
-  if (parser.compile(expression_, expression)) {
-    valid = true;
-  };
-  return valid;
+bool s21::CalculatorModel::CalculateBatch(const std::string &expression,
+                                          const double *x_values,
+                                          double *results, size_t count) {
+  LoadProgram(expression);
+  evaluator_.EvaluateBatch(x_values, results, count);
+  return program_->IsValid();
+}
+
+s21::Dual s21::CalculatorModel::Differentiate(const std::string &expression) {
+  LoadProgram(expression);
+  return evaluator_.EvaluateDual(x_value_);
+}
+
+std::vector<double> s21::CalculatorModel::FindRoots(
+    const std::string &expression, double x_min, double x_max) {
+  return RootFinder(Compile(expression)).FindRoots(x_min, x_max);
 }
 
-void s21::CalculatorModel::SubstituteExpression() {
-  ReplaceInExpression("log", "log10");
-  ReplaceInExpression("ln", "log");
-  ReplaceInExpression("mod", "%");
-  ReplaceInExpression("E", "*10^");
+s21::Integral s21::CalculatorModel::Integrate(const std::string &expression,
+                                              double a, double b) {
+  return Integrator(Compile(expression)).Integrate(a, b);
 }
 
-void s21::CalculatorModel::ReplaceInExpression(const std::string &from,
-                                               const std::string &to) {
-  size_t start_index = 0;
-  while ((start_index = expression_.find(from, start_index)) !=
-         std::string::npos) {
-    expression_.replace(start_index, from.length(), to);
-    start_index += to.length();
+// Reloading the evaluator drops its JIT state, so it is reloaded only when
+// the cache gives back a different program.
+void s21::CalculatorModel::LoadProgram(const std::string &expression) {
+  std::shared_ptr<const Program> program = Compile(expression);
+  if (program != program_) {
+    program_ = std::move(program);
+    evaluator_.Load(program_);
   }
 }
 
-void s21::CalculatorModel::ConvertExpressionToPostfix() {
+std::shared_ptr<const s21::Program>
+s21::CalculatorModel::Compile(const std::string &expression) {
+  std::shared_ptr<const Program> cached = cache_.Find(expression);
+  if (cached) {
+    return cached;
+  }
+  auto program = std::make_shared<Program>();
+  SetExpression(expression);
+  if (ConvertExpressionToPostfix()) {
+    EmitProgram(*program);
+  } else {
+    program->SetError(error_position_);
+  }
+  postfix_.clear();
+  cache_.Insert(expression, program);
+  return program;
+}
+
+bool s21::CalculatorModel::ConvertExpressionToPostfix() {
   expect_unary_operator_ = true;
+  error_position_ = std::string::npos;
   int which = 0;
   size_t index = 0;
   size_t expression_length = expression_.length();
@@ -91,24 +121,27 @@ void s21::CalculatorModel::ConvertExpressionToPostfix() {
   postfix_.clear();
   ClearStackOfOperators();
 
-  while (index < expression_length) {
-    if (IsNumber(index)) {
+  while (index < expression_length && !HasError()) {
+    if (IsSpace(index)) {
+      ++index;
+    } else if (IsNumber(index)) {
       HandleNumber(index);
     } else if (IsX(index)) {
       HandleX(index);
     } else if ((which = IsFunction(index))) {
-      HandleFunction(which);
+      HandleFunction(index, which);
     } else if (IsOpeningBrace(index)) {
       HandleOpeningBrace(index);
     } else if (IsClosingBrace(index)) {
       HandleClosingBrace(index);
+    } else if (IsExponent(index)) {
+      HandleExponent(index);
     } else {
       HandleOperator(index);
     }
   }
-  while (StackOfOperatorsIsNotEmpty()) {
-    MoveOperatorsFromStackToVector();
-  }
+  HandleEndOfExpression();
+  return !HasError();
 }
 
 void s21::CalculatorModel::ClearStackOfOperators() {
@@ -121,22 +154,53 @@ bool s21::CalculatorModel::StackOfOperatorsIsNotEmpty() {
   return !stack_of_operators_.empty();
 }
 
+void s21::CalculatorModel::SetError(size_t index) {
+  if (!HasError()) {
+    error_position_ = index;
+  }
+}
+
+bool s21::CalculatorModel::IsSpace(size_t index) const {
+  return std::isspace(static_cast<unsigned char>(expression_[index]));
+}
+
 bool s21::CalculatorModel::IsNumber(size_t index) const {
   return std::isdigit(expression_[index]) || expression_[index] == '.';
 }
 
 void s21::CalculatorModel::HandleNumber(size_t &index) {
-  postfix_.emplace_back(LexemType::kTypeNumber, Lexem::kNumber,
-                        ExtractDigit(index));
-  expect_unary_operator_ = false;
+  if (!expect_unary_operator_) {
+    SetError(index);
+    return;
+  }
+  double number = ExtractDigit(index);
+  if (!HasError()) {
+    postfix_.emplace_back(LexemType::kTypeNumber, Lexem::kNumber, number);
+    expect_unary_operator_ = false;
+  }
 }
 
 double s21::CalculatorModel::ExtractDigit(size_t &index) {
   size_t start_index = index;
+  bool has_digits = false;
+  bool has_dot = false;
   while (index < expression_.length() &&
-         (std::isdigit(expression_[index]) || expression_[index] == '.'))
+         (std::isdigit(expression_[index]) || expression_[index] == '.')) {
+    if (expression_[index] == '.') {
+      if (has_dot) {
+        SetError(index);
+      }
+      has_dot = true;
+    } else {
+      has_digits = true;
+    }
     ++index;
-  return std::stod(expression_.substr(start_index, index - start_index));
+  }
+  if (!has_digits) {
+    SetError(start_index);
+  }
+  std::string digits = expression_.substr(start_index, index - start_index);
+  return std::strtod(digits.c_str(), nullptr);
 }
 
 bool s21::CalculatorModel::IsX(size_t index) const {
@@ -144,38 +208,40 @@ bool s21::CalculatorModel::IsX(size_t index) const {
 }
 
 void s21::CalculatorModel::HandleX(size_t &index) {
+  if (!expect_unary_operator_) {
+    SetError(index);
+    return;
+  }
   postfix_.emplace_back(LexemType::kTypeNumber, Lexem::kVariableX);
   expect_unary_operator_ = false;
   ++index;
 }
 
 int s21::CalculatorModel::IsFunction(size_t &index) {
-  if (index + 4 < expression_.length() &&
-      expression_.substr(index, 5) == "log10") {
-    index += 5;
-    return static_cast<int>(Lexem::kLog10);
-  }
   for (const auto &function : functions_) {
     const std::string &func_str = function.first;
-    if (index + func_str.length() <= expression_.length()) {
-      std::string func_candidate = expression_.substr(index, func_str.length());
-      if (func_candidate == func_str) {
-        if (!expect_unary_operator_ && (func_candidate == "-")) {
-          break;
-        } else {
-          index += func_str.length();
-          return static_cast<int>(function.second);
-        }
-      }
+    if (expression_.compare(index, func_str.length(), func_str) == 0) {
+      index += func_str.length();
+      return static_cast<int>(function.second);
     }
   }
   return 0;
 }
 
-void s21::CalculatorModel::HandleFunction(int type_function) {
-  stack_of_operators_.emplace(LexemType::kTypeFunction,
-                              static_cast<Lexem>(type_function));
-  expect_unary_operator_ = false;
+void s21::CalculatorModel::HandleFunction(size_t &index, int type_function) {
+  size_t brace_index = index;
+  while (brace_index < expression_.length() && IsSpace(brace_index)) {
+    ++brace_index;
+  }
+  if (!expect_unary_operator_) {
+    SetError(index);
+  } else if (brace_index == expression_.length() ||
+             !IsOpeningBrace(brace_index)) {
+    SetError(brace_index);
+  } else {
+    stack_of_operators_.emplace(LexemType::kTypeFunction,
+                                static_cast<Lexem>(type_function));
+  }
 }
 
 bool s21::CalculatorModel::IsOpeningBrace(size_t index) const {
@@ -183,7 +249,12 @@ bool s21::CalculatorModel::IsOpeningBrace(size_t index) const {
 }
 
 void s21::CalculatorModel::HandleOpeningBrace(size_t &index) {
-  stack_of_operators_.emplace(LexemType::kTypeOperator, Lexem::kOpenBrace);
+  if (!expect_unary_operator_) {
+    SetError(index);
+    return;
+  }
+  stack_of_operators_.emplace(LexemType::kTypeOperator, Lexem::kOpenBrace,
+                              static_cast<double>(index));
   expect_unary_operator_ = true;
   ++index;
 }
@@ -193,39 +264,95 @@ bool s21::CalculatorModel::IsClosingBrace(size_t index) const {
 }
 
 void s21::CalculatorModel::HandleClosingBrace(size_t &index) {
-  ++index;
+  if (expect_unary_operator_) {
+    SetError(index);
+    return;
+  }
   while (StackOfOperatorsIsNotEmpty() &&
          stack_of_operators_.top().GetName() != Lexem::kOpenBrace) {
     MoveOperatorsFromStackToVector();
   }
-  if (StackOfOperatorsIsNotEmpty() &&
-      stack_of_operators_.top().GetName() == Lexem::kOpenBrace) {
+  if (StackOfOperatorsIsNotEmpty()) {
     stack_of_operators_.pop();
+  } else {
+    SetError(index);
   }
   expect_unary_operator_ = false;
+  ++index;
+}
+
+bool s21::CalculatorModel::IsExponent(size_t index) const {
+  return expression_[index] == 'E';
+}
+
+void s21::CalculatorModel::HandleExponent(size_t &index) {
+  if (expect_unary_operator_) {
+    SetError(index);
+    return;
+  }
+  PushOperator(Lexem::kMul);
+  postfix_.emplace_back(LexemType::kTypeNumber, Lexem::kNumber, 10.0);
+  PushOperator(Lexem::kDeg);
+  ++index;
 }
 
 void s21::CalculatorModel::HandleOperator(size_t &index) {
-  Lexem handling_operator = CharToLexem(expression_[index++]);
+  size_t start_index = index;
+  Lexem handling_operator{};
+  if (!ExtractOperator(index, handling_operator)) {
+    SetError(start_index);
+  } else if (!expect_unary_operator_) {
+    PushOperator(handling_operator);
+  } else if (handling_operator == Lexem::kSub) {
+    stack_of_operators_.emplace(LexemType::kTypeFunction, Lexem::kUnaryMinus);
+  } else if (handling_operator != Lexem::kSum) {
+    SetError(start_index);
+  }
+}
+
+void s21::CalculatorModel::HandleEndOfExpression() {
+  if (expect_unary_operator_) {
+    SetError(expression_.length());
+  }
+  while (!HasError() && StackOfOperatorsIsNotEmpty()) {
+    if (stack_of_operators_.top().GetName() == Lexem::kOpenBrace) {
+      SetError(static_cast<size_t>(stack_of_operators_.top().GetValue()));
+    } else {
+      MoveOperatorsFromStackToVector();
+    }
+  }
+}
+
+bool s21::CalculatorModel::ExtractOperator(size_t &index, Lexem &oper) {
+  if (expression_.compare(index, 3, "mod") == 0) {
+    oper = Lexem::kMod;
+    index += 3;
+    return true;
+  }
+  auto found = operators_.find(expression_[index]);
+  if (found == operators_.end()) {
+    return false;
+  }
+  oper = found->second;
+  ++index;
+  return true;
+}
+
+void s21::CalculatorModel::PushOperator(Lexem oper) {
   while (StackOfOperatorsIsNotEmpty() &&
          stack_of_operators_.top().GetName() != Lexem::kOpenBrace &&
          GetPriority(stack_of_operators_.top().GetName()) <=
-             GetPriority(handling_operator)) {
-    if (handling_operator == Lexem::kDeg &&
+             GetPriority(oper)) {
+    if (oper == Lexem::kDeg &&
         stack_of_operators_.top().GetName() == Lexem::kDeg) {
       break;
     }
     MoveOperatorsFromStackToVector();
   }
-  stack_of_operators_.emplace(LexemType::kTypeOperator, handling_operator);
+  stack_of_operators_.emplace(LexemType::kTypeOperator, oper);
   expect_unary_operator_ = true;
 }
 
-s21::CalculatorModel::Lexem s21::CalculatorModel::CharToLexem(
-    const char &oper_candidate) {
-  return operators_.at(oper_candidate);
-}
-
 int s21::CalculatorModel::GetPriority(const Lexem &lexem) {
   return priorities_.at(lexem);
 }
@@ -235,42 +362,23 @@ void s21::CalculatorModel::MoveOperatorsFromStackToVector() {
   stack_of_operators_.pop();
 }
 
-void s21::CalculatorModel::CalculateExpression() {
-  if (!postfix_.empty()) {
-    CalculatePostfix();
-  }
-}
-
-void s21::CalculatorModel::CalculatePostfix() {
-  std::stack<double> numbers;
-  for (size_t index = 0; index < postfix_.size(); ++index) {
-    Token current = postfix_[index];
-    if (IsNumericToken(current)) {
-      HandleNumericToken(current, numbers);
-    } else if (IsFunctionToken(current)) {
-      HandleFunctionToken(current, numbers);
-    } else if (IsOperationToken(current)) {
-      HandleOperationToken(current, numbers);
+void s21::CalculatorModel::EmitProgram(Program &program) {
+  Compiler compiler;
+  std::vector<Compiler::Node> operands;
+  for (const Token &token : postfix_) {
+    if (IsNumericToken(token)) {
+      EmitNumericToken(token, compiler, operands);
+    } else {
+      EmitOperationToken(token, compiler, operands);
     }
   }
-  if (numbers.size() == 1) {
-    result_ = numbers.top();
-  }
+  compiler.Emit(operands.back(), program);
 }
 
 bool s21::CalculatorModel::IsNumericToken(const Token &token) {
   return token.GetType() == LexemType::kTypeNumber;
 }
 
-void s21::CalculatorModel::HandleNumericToken(const Token &token,
-                                              std::stack<double> &numbers) {
-  if (IsXToken(token)) {
-    numbers.push(x_value_);
-  } else {
-    numbers.push(token.GetValue());
-  }
-}
-
 bool s21::CalculatorModel::IsXToken(const Token &token) {
   return token.GetName() == Lexem::kVariableX;
 }
@@ -279,82 +387,32 @@ bool s21::CalculatorModel::IsFunctionToken(const Token &token) {
   return token.GetType() == LexemType::kTypeFunction;
 }
 
-bool s21::CalculatorModel::IsOperationToken(const Token &token) {
-  return token.GetType() == LexemType::kTypeOperator;
+void s21::CalculatorModel::EmitNumericToken(
+    const Token &token, Compiler &compiler,
+    std::vector<Compiler::Node> &operands) {
+  if (IsXToken(token)) {
+    operands.push_back(compiler.AddVariable());
+  } else {
+    operands.push_back(compiler.AddConstant(token.GetValue()));
+  }
 }
 
-void s21::CalculatorModel::HandleFunctionToken(const Token &token,
-                                               std::stack<double> &numbers) {
-  double num = numbers.top();
-  numbers.pop();
-
-  double result;
-  switch (token.GetName()) {
-    case Lexem::kUnaryMinus:
-      result = -1 * num;
-      break;
-    case Lexem::kSqrt:
-      result = std::sqrt(num);
-      break;
-    case Lexem::kLog10:
-      result = std::log10(num);
-      break;
-    case Lexem::kLog:
-      result = std::log(num);
-      break;
-    case Lexem::kSin:
-      result = std::sin(num);
-      break;
-    case Lexem::kCos:
-      result = std::cos(num);
-      break;
-    case Lexem::kTan:
-      result = std::tan(num);
-      break;
-    case Lexem::kArcSin:
-      result = std::asin(num);
-      break;
-    case Lexem::kArcCos:
-      result = std::acos(num);
-      break;
-    default: /*Lexem::kArcTan*/
-      result = std::atan(num);
-      break;
-  }
-  numbers.push(result);
-}
-
-void s21::CalculatorModel::HandleOperationToken(const Token &token,
-                                                std::stack<double> &numbers) {
-  if (numbers.size() >= 2) {
-    double rhs = numbers.top();
-    numbers.pop();
-    double lhs = numbers.top();
-    numbers.pop();
-
-    double result;
-    switch (token.GetName()) {
-      case Lexem::kSum:
-        result = lhs + rhs;
-        break;
-      case Lexem::kSub:
-        result = lhs - rhs;
-        break;
-      case Lexem::kMul:
-        result = lhs * rhs;
-        break;
-      case Lexem::kDiv:
-        result = lhs / rhs;
-        break;
-      case Lexem::kMod:
-        result = std::fmod(lhs, rhs);
-        break;
-      default: /*Lexem::kDeg*/
-        result = std::pow(lhs, rhs);
-        break;
-    }
-    numbers.push(result);
+void s21::CalculatorModel::EmitOperationToken(
+    const Token &token, Compiler &compiler,
+    std::vector<Compiler::Node> &operands) {
+  Compiler::Node rhs = operands.back();
+  operands.pop_back();
+  Compiler::Node lhs = rhs;
+  if (!IsFunctionToken(token)) {
+    lhs = operands.back();
+    operands.pop_back();
   }
+  operands.push_back(
+      compiler.AddOperation(opcodes_.at(token.GetName()), lhs, rhs));
+}
+
+void s21::CalculatorModel::CalculateExpression() {
+  result_ = evaluator_.Evaluate(x_value_);
 }
 
 void s21::CalculatorModel::ConvertResultToString() {
@@ -385,78 +443,49 @@ void s21::CalculatorModel::TrimTrailingZeros() {
   result_string_ = result_string_.substr(0, ++iter);
 }
 
-void s21::CalculatorModel::CalculateDots(const std::string &expression,
-                                         std::vector<double> plot_limits) {
-  plot_.SetPlotLimits(std::move(plot_limits));
-  Calculate(expression);
-  plot_.CalculateDots(this);
-}
-
-void s21::CalculatorModel::Plot::SetPlotLimits(
-    std::vector<double> plot_limits) {
-  x_min_ = plot_limits[0];
-  x_max_ = plot_limits[1];
-  y_min_ = plot_limits[2];
-  y_max_ = plot_limits[3];
-}
-
-void s21::CalculatorModel::Plot::CalculateDots(CalculatorModel *model) {
-  InitializeData();
-  while (x_curr_ <= x_max_) {
-    AdjustDot(model);
-    UpdatePreviousValues();
-    AddDotToList();
+std::shared_ptr<const s21::Program>
+s21::CalculatorModel::ProgramCache::Find(const std::string &expression) {
+  auto found = index_.find(expression);
+  if (found == index_.end()) {
+    ++misses_;
+    return nullptr;
   }
-}
-
-void s21::CalculatorModel::Plot::InitializeData() {
-  list_x_.clear();
-  list_y_.clear();
-  x_step_ = (x_max_ - x_min_) / 290;
-  y_step_ = (y_max_ - y_min_) / 250;
-  x_curr_ = x_min_;
-  x_prev_ = x_min_ - x_step_;
-  y_prev_ = y_min_;
-}
-
-void s21::CalculatorModel::Plot::AdjustDot(CalculatorModel *model) {
-  CalculateOneDot(x_curr_, model);
-  if (IsValidDot()) {
-    CalculateDeltas();
-
-    while (delta_x_ > x_step_ && delta_y_ > y_step_) {
-      if (delta_x_ > x_step_ || delta_y_ > y_step_) {
-        x_step_ /= 1.01;
-      }
-      CalculateOneDot(x_prev_, model);
-      CalculateDeltas();
-    }
+  ++hits_;
+  entries_.splice(entries_.begin(), entries_, found->second);
+  return found->second->second;
+}
+
+void s21::CalculatorModel::ProgramCache::Insert(
+    const std::string &expression, std::shared_ptr<const Program> program) {
+  auto found = index_.find(expression);
+  if (found != index_.end()) {
+    found->second->second = std::move(program);
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return;
   }
+  entries_.emplace_front(expression, std::move(program));
+  index_.emplace(expression, entries_.begin());
+  EvictExcess();
 }
 
-void s21::CalculatorModel::Plot::CalculateOneDot(const double &x_prev,
-                                                 CalculatorModel *model) {
-  x_curr_ = x_prev + x_step_;
-  model->SetXValue(x_curr_);
-  model->CalculateExpression();
-  y_curr_ = model->result_;
-}
-
-bool s21::CalculatorModel::Plot::IsValidDot() const {
-  return (y_curr_ != 0 && y_curr_ >= y_min_ && y_curr_ <= y_max_);
-}
-
-void s21::CalculatorModel::Plot::CalculateDeltas() {
-  delta_x_ = x_curr_ - x_prev_;
-  delta_y_ = x_curr_ - y_prev_;
+void s21::CalculatorModel::ProgramCache::SetCapacity(size_t capacity) {
+  capacity_ = capacity;
+  EvictExcess();
 }
 
-void s21::CalculatorModel::Plot::UpdatePreviousValues() {
-  x_prev_ = x_curr_;
-  y_prev_ = y_curr_;
+void s21::CalculatorModel::ProgramCache::EvictExcess() {
+  while (entries_.size() > capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
 }
 
-void s21::CalculatorModel::Plot::AddDotToList() {
-  list_x_.emplace_back(x_curr_);
-  list_y_.emplace_back(y_curr_);
+void s21::CalculatorModel::CalculateDots(const std::string &expression,
+                                         std::vector<double> plot_limits,
+                                         PlotBudget budget) {
+  plot_.SetPlotLimits(std::move(plot_limits));
+  plot_.SetBudget(budget);
+  plot_.SetTileCache(tiles_);
+  Calculate(expression);
+  plot_.CalculateDots(program_);
 }
@@ -1,11 +1,23 @@
 #ifndef SRC_MODEL_MAIN_MODEL_H_
 #define SRC_MODEL_MAIN_MODEL_H_
 
-#include <sstream>
+#include <cmath>
+#include <limits>
 #include <list>
+#include <memory>
+#include <sstream>
+#include <stack>
 #include <string>
 #include <unordered_map>
-#include "../rcs/exprtk.hpp"
+#include <utility>
+#include <vector>
+
+#include "compiler.h"
+#include "evaluator.h"
+#include "integral.h"
+#include "plot.h"
+#include "program.h"
+#include "roots.h"
 
 namespace s21 {
 class CalculatorModel {
@@ -14,11 +26,47 @@ class CalculatorModel {
 
   void SetXValue(double x) { x_value_ = x; };
   void Calculate(const std::string &expression);
+  bool CalculateBatch(const std::string &expression, const double *x_values,
+                      double *results, size_t count);
   std::string GetResultString() { return result_string_; };
-  void CalculateDots(const std::string &expression, std::vector<double> plot_limits);
-  std::pair<std::list<double>, std::list<double>> GetDots() {
-    return {plot_.GetListX(), plot_.GetListY() };
-  };
+  // f(X), f'(X) and f''(X) at the value set by SetXValue(), all NaN when the
+  // expression is invalid.
+  Dual Differentiate(const std::string &expression);
+  // Zeros of the expression in [x_min, x_max] where it changes sign.
+  std::vector<double> FindRoots(const std::string &expression, double x_min,
+                                double x_max);
+  // Definite integral of the expression from a to b with its estimated
+  // error, both NaN when the expression is invalid.
+  Integral Integrate(const std::string &expression, double a, double b);
+  void CalculateDots(const std::string &expression, std::vector<double> plot_limits,
+                     PlotBudget budget = {});
+  std::vector<Dot> TakeDots() { return plot_.TakeDots(); }
+  bool IsPlotPartial() const { return plot_.IsPartial(); }
+  size_t GetTileHits() const { return tiles_->GetHits(); }
+  size_t GetTileMisses() const { return tiles_->GetMisses(); }
+  // Compiles on the calling thread; the job may then run on any thread.
+  std::shared_ptr<PlotJob> PreparePlot(const std::string &expression,
+                                       std::vector<double> plot_limits,
+                                       PlotBudget budget = {}) {
+    auto job = std::make_shared<PlotJob>(Compile(expression),
+                                         std::move(plot_limits));
+    job->SetBudget(budget);
+    job->SetTileCache(tiles_);
+    return job;
+  }
+  // Instructions run per sample by the last calculated expression.
+  size_t GetInstructionCount() const {
+    return program_ ? program_->GetInstructions().size() : 0;
+  }
+  // Whether the last calculated expression has been compiled to native code.
+  bool IsCompiled() const { return program_ && program_->IsCompiled(); }
+  size_t GetErrorPosition() const {
+    return program_ ? program_->GetErrorPosition() : std::string::npos;
+  }
+  std::string GetKernelsName() const { return DefaultKernels().GetName(); }
+  size_t GetCacheHits() const { return cache_.GetHits(); }
+  size_t GetCacheMisses() const { return cache_.GetMisses(); }
+  void SetCacheCapacity(size_t capacity) { cache_.SetCapacity(capacity); }
 
  private:
   enum class Lexem : int {
@@ -50,91 +98,99 @@ class CalculatorModel {
     double value_{};
   };  // class Token
 
-  class Plot {
+  // Least recently used cache of compiled programs keyed by the raw
+  // expression string, so that repeated evaluations skip parsing.
+  class ProgramCache {
    public:
-    void SetPlotLimits(std::vector<double> plot_limits);
-    void CalculateDots(CalculatorModel *model);
-    void InitializeData();
-    void AdjustDot(CalculatorModel *model);
-    void CalculateOneDot (const double &x_prev, CalculatorModel *model);
-    bool IsValidDot() const;
-    void CalculateDeltas();
-    void UpdatePreviousValues();
-    void AddDotToList();
-
-    std::list<double> GetListX() { return list_x_; }
-    std::list<double> GetListY() { return list_y_; }
+    explicit ProgramCache(size_t capacity) : capacity_(capacity) {}
+    std::shared_ptr<const Program> Find(const std::string &expression);
+    void Insert(const std::string &expression,
+                std::shared_ptr<const Program> program);
+    void SetCapacity(size_t capacity);
+    size_t GetHits() const { return hits_; }
+    size_t GetMisses() const { return misses_; }
 
    private:
-    double x_min_{};
-    double x_max_{};
-    double y_min_{};
-    double y_max_{};
-    double x_curr_{};
-    double x_prev_{};
-    double y_curr_{};
-    double y_prev_{};
-    double x_step_{};
-    double y_step_{};
-    double delta_x_{};
-    double delta_y_{};
-    std::list<double> list_x_{};
-    std::list<double> list_y_{};
-  };  // class Plot
+    using Entry = std::pair<std::string, std::shared_ptr<const Program>>;
+
+    void EvictExcess();
+
+    size_t capacity_{};
+    size_t hits_{};
+    size_t misses_{};
+    std::list<Entry> entries_{};
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_{};
+  };  // class ProgramCache
+
+  static constexpr size_t kCacheCapacity = 512;
+  static constexpr size_t kTileCapacity = 4096;
 
   Plot plot_;
+  std::shared_ptr<TileCache> tiles_{std::make_shared<TileCache>(kTileCapacity)};
+  ProgramCache cache_{kCacheCapacity};
+  std::shared_ptr<const Program> program_{};
+  Evaluator evaluator_{};
   std::string expression_{};
   std::string result_string_{};
   double result_{};
   double x_value_{};
   bool expect_unary_operator_{};
+  size_t error_position_{std::string::npos};
   std::vector<Token> postfix_{};
   std::unordered_map<std::string, Lexem> functions_;
   std::unordered_map<char, Lexem> operators_;
   std::unordered_map<Lexem, int> priorities_;
+  std::unordered_map<Lexem, OpCode> opcodes_;
   std::stack<Token> stack_of_operators_;
 
   void InitFunctions();
   void InitOperators();
   void InitPriorities();
+  void InitOpCodes();
 
   void SetExpression(const std::string &expression) { expression_ = expression; };
-  bool IsExpressionValid();
-  void SubstituteExpression();
-  void ReplaceInExpression(const std::string &from, const std::string &to);
-  void ConvertExpressionToPostfix();
+  void LoadProgram(const std::string &expression);
+  std::shared_ptr<const Program> Compile(const std::string &expression);
+  bool ConvertExpressionToPostfix();
   void ClearStackOfOperators();
   bool StackOfOperatorsIsNotEmpty();
+  void SetError(size_t index);
+  bool HasError() const { return error_position_ != std::string::npos; }
 
+  bool IsSpace(size_t index) const;
   bool IsNumber(size_t index) const;
   bool IsX(size_t index) const;
   int IsFunction(size_t &index);
   bool IsOpeningBrace(size_t index) const;
   bool IsClosingBrace(size_t index) const;
+  bool IsExponent(size_t index) const;
 
   void HandleX(size_t &index);
-  void HandleFunction(int type_function);
+  void HandleFunction(size_t &index, int type_function);
   void HandleOpeningBrace(size_t &index);
   void HandleClosingBrace(size_t &index);
   void HandleNumber(size_t &index);
+  void HandleExponent(size_t &index);
   void HandleOperator(size_t &index);
+  void HandleEndOfExpression();
 
-  double ExtractDigit(size_t &pos);
-  Lexem CharToLexem(const char &oper);
+  double ExtractDigit(size_t &index);
+  bool ExtractOperator(size_t &index, Lexem &oper);
+  void PushOperator(Lexem oper);
   int GetPriority(const Lexem &lexem);
 
   void MoveOperatorsFromStackToVector();
+  void EmitProgram(Program &program);
   void CalculateExpression();
-  void CalculatePostfix();
 
   bool IsNumericToken(const Token &token);
   bool IsXToken(const Token &token);
   bool IsFunctionToken(const Token &token);
-  bool IsOperationToken(const Token &token);
 
-  void HandleNumericToken(const Token &token, std::stack<double> &numbers);
-  void HandleFunctionToken(const Token &token, std::stack<double> &numbers);
-  void HandleOperationToken(const Token &token, std::stack<double> &numbers);
+  void EmitNumericToken(const Token &token, Compiler &compiler,
+                        std::vector<Compiler::Node> &operands);
+  void EmitOperationToken(const Token &token, Compiler &compiler,
+                          std::vector<Compiler::Node> &operands);
 
   void ConvertResultToString();
   bool IsResultError() const;
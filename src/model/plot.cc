@@ -0,0 +1,551 @@
+#include "plot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <future>
+#include <utility>
+
+#include "roots.h"
+#include "thread_pool.h"
+
+size_t s21::TileKeyHash::operator()(const TileKey &key) const {
+  size_t hash = std::hash<const Program *>()(key.program.get());
+  hash = hash * 31 + std::hash<int>()(key.x_level);
+  hash = hash * 31 + std::hash<int>()(key.y_level);
+  hash = hash * 31 + std::hash<int64_t>()(key.first_band);
+  hash = hash * 31 + std::hash<int64_t>()(key.last_band);
+  hash = hash * 31 + std::hash<size_t>()(key.derivative);
+  return hash * 31 + std::hash<int64_t>()(key.index);
+}
+
+s21::TileCache::Tile s21::TileCache::Find(const TileKey &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = index_.find(key);
+  if (found == index_.end()) {
+    ++misses_;
+    return nullptr;
+  }
+  ++hits_;
+  entries_.splice(entries_.begin(), entries_, found->second);
+  return found->second->second;
+}
+
+void s21::TileCache::Insert(const TileKey &key, Tile tile) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    found->second->second = std::move(tile);
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return;
+  }
+  entries_.emplace_front(key, std::move(tile));
+  index_[key] = entries_.begin();
+  EvictExcess();
+}
+
+size_t s21::TileCache::GetHits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+size_t s21::TileCache::GetMisses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+void s21::TileCache::EvictExcess() {
+  while (entries_.size() > capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+
+void s21::Plot::SetPlotLimits(std::vector<double> plot_limits) {
+  if (plot_limits.size() < 4) {
+    x_min_ = x_max_ = y_min_ = y_max_ = 0;
+    return;
+  }
+  x_min_ = plot_limits[0];
+  x_max_ = plot_limits[1];
+  y_min_ = plot_limits[2];
+  y_max_ = plot_limits[3];
+}
+
+void s21::Plot::SetViewport(size_t width, size_t height) {
+  width_ = std::max<size_t>(width, 1);
+  height_ = std::max<size_t>(height, 1);
+}
+
+// The resolutions are positive and finite only for increasing finite
+// ranges that are not too narrow for the viewport.
+bool s21::Plot::HasValidLimits() const {
+  double x_resolution = static_cast<double>(width_) / (x_max_ - x_min_);
+  double y_resolution = static_cast<double>(height_) / (y_max_ - y_min_);
+  return x_resolution > 0 && std::isfinite(x_resolution) &&
+         y_resolution > 0 && std::isfinite(y_resolution);
+}
+
+size_t s21::Plot::GetMaxEvaluations() const {
+  return budget_.max_evaluations ? budget_.max_evaluations
+                                 : kEvaluationsPerColumn * width_;
+}
+
+void s21::Plot::Clear() {
+  dots_.clear();
+  evaluations_ = 0;
+  partial_ = false;
+}
+
+bool s21::Plot::CalculateDots(const std::shared_ptr<const Program> &program,
+                              const std::atomic<bool> *cancelled,
+                              const ProgressCallback &on_progress) {
+  Clear();
+  if (!program || !program->IsValid()) {
+    return true;
+  }
+  if (!HasValidLimits()) {
+    partial_ = true;
+    return true;
+  }
+  int x_level = GetXLevel();
+  int y_level = GetYLevel();
+  double tile_width = GetTileWidth(x_level);
+  double x_scale = std::ldexp(1.0, x_level);
+  double y_scale = std::ldexp(1.0, y_level);
+  auto [first_band, last_band] = GetBands(y_level);
+  double band_height = std::ldexp(kBandHeight, -y_level);
+  Interval window = {band_height * static_cast<double>(first_band),
+                     band_height * static_cast<double>(last_band + 1)};
+  int64_t first = GetFirstTile(x_level);
+  size_t count = static_cast<size_t>(GetLastTile(x_level) - first + 1);
+  size_t budget = GetMaxEvaluations() / count;
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + budget_.time_limit;
+
+  std::vector<TileCache::Tile> tiles(count);
+  std::vector<std::future<Sampler>> samplers(count);
+  for (size_t i = 0; i < count; ++i) {
+    int64_t index = first + static_cast<int64_t>(i);
+    if (tiles_) {
+      tiles[i] = tiles_->Find(
+          {program, x_level, y_level, index, first_band, last_band,
+           derivative_});
+    }
+    if (!tiles[i]) {
+      double from = tile_width * static_cast<double>(index);
+      double to = from + tile_width;
+      samplers[i] = ThreadPool::Shared().Submit([=]() {
+        Sampler sampler(program, from, to, x_scale, y_scale, window,
+                        derivative_, budget, deadline, cancelled);
+        sampler.CalculateDots();
+        return sampler;
+      });
+    }
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (samplers[i].valid()) {
+      Sampler sampler = samplers[i].get();
+      evaluations_ += sampler.GetEvaluations();
+      partial_ = partial_ || sampler.IsPartial();
+      bool complete = !sampler.IsPartial() && !(cancelled && *cancelled);
+      tiles[i] = std::make_shared<const std::vector<Dot>>(sampler.TakeDots());
+      if (tiles_ && complete) {
+        int64_t index = first + static_cast<int64_t>(i);
+        tiles_->Insert(
+            {program, x_level, y_level, index, first_band, last_band,
+             derivative_},
+            tiles[i]);
+      }
+    }
+    if (on_progress && !(cancelled && *cancelled)) {
+      on_progress(static_cast<double>(i + 1) / static_cast<double>(count));
+    }
+  }
+  if (cancelled && *cancelled) {
+    return false;
+  }
+  Stitch(tiles, dots_);
+  return true;
+}
+
+bool s21::Plot::FindCoarserDots(const std::shared_ptr<const Program> &program,
+                                std::vector<Dot> &dots) const {
+  if (!tiles_ || !HasValidLimits()) {
+    return false;
+  }
+  int y_level = GetYLevel();
+  for (int x_level = GetXLevel() - 1; x_level >= GetXLevel() - kCoarserLevels;
+       --x_level) {
+    for (int dy = -kCoarserLevels; dy <= kCoarserLevels; ++dy) {
+      int64_t first = GetFirstTile(x_level);
+      int64_t last = GetLastTile(x_level);
+      auto [first_band, last_band] = GetBands(y_level + dy);
+      std::vector<TileCache::Tile> tiles;
+      for (int64_t index = first; index <= last; ++index) {
+        TileCache::Tile tile =
+            tiles_->Find({program, x_level, y_level + dy, index, first_band,
+                          last_band, derivative_});
+        if (!tile) {
+          break;
+        }
+        tiles.push_back(std::move(tile));
+      }
+      if (tiles.size() == static_cast<size_t>(last - first + 1)) {
+        Stitch(tiles, dots);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// The sampled resolution is the power of two at or above the viewport
+// one, so a tile spans more than half and at most all of kTileColumns
+// pixel columns.
+int s21::Plot::GetXLevel() const {
+  return static_cast<int>(std::ceil(
+      std::log2(static_cast<double>(width_) / (x_max_ - x_min_))));
+}
+
+int s21::Plot::GetYLevel() const {
+  return static_cast<int>(std::ceil(
+      std::log2(static_cast<double>(height_) / (y_max_ - y_min_))));
+}
+
+std::pair<int64_t, int64_t> s21::Plot::GetBands(int y_level) const {
+  double band_height = std::ldexp(kBandHeight, -y_level);
+  return {static_cast<int64_t>(std::floor(y_min_ / band_height)) - 1,
+          static_cast<int64_t>(std::floor(y_max_ / band_height)) + 1};
+}
+
+double s21::Plot::GetTileWidth(int x_level) const {
+  return std::ldexp(static_cast<double>(kTileColumns), -x_level);
+}
+
+int64_t s21::Plot::GetFirstTile(int x_level) const {
+  return static_cast<int64_t>(std::floor(x_min_ / GetTileWidth(x_level)));
+}
+
+int64_t s21::Plot::GetLastTile(int x_level) const {
+  int64_t last =
+      static_cast<int64_t>(std::ceil(x_max_ / GetTileWidth(x_level))) - 1;
+  return std::max(last, GetFirstTile(x_level));
+}
+
+void s21::Plot::Stitch(const std::vector<TileCache::Tile> &tiles,
+                       std::vector<Dot> &dots) const {
+  dots.clear();
+  for (const TileCache::Tile &tile : tiles) {
+    // Neighbouring tiles share their boundary dot.
+    for (const Dot &dot : *tile) {
+      if (dots.empty() || dot.x > dots.back().x) {
+        dots.push_back(dot);
+      }
+    }
+  }
+  // Keep one dot on each side of the range so the curve reaches its edges.
+  auto begin = std::lower_bound(
+      dots.begin(), dots.end(), x_min_,
+      [](const Dot &dot, double x) { return dot.x < x; });
+  auto end = std::upper_bound(
+      dots.begin(), dots.end(), x_max_,
+      [](double x, const Dot &dot) { return x < dot.x; });
+  if (begin != dots.begin()) {
+    --begin;
+  }
+  if (end != dots.end()) {
+    ++end;
+  }
+  dots.erase(end, dots.end());
+  dots.erase(dots.begin(), begin);
+  Decimate(dots);
+}
+
+void s21::Plot::Decimate(std::vector<Dot> &dots) const {
+  double column_width = (x_max_ - x_min_) / static_cast<double>(width_);
+  auto column_of = [&](const Dot &dot) {
+    double column = std::floor((dot.x - x_min_) / column_width);
+    return std::clamp(column, 0.0, static_cast<double>(width_ - 1));
+  };
+  std::vector<Dot> decimated;
+  decimated.reserve(std::min(dots.size(), width_ * 4 + 2));
+  size_t first = 0;
+  while (first < dots.size()) {
+    // NaN dots break the curve, a run of them is kept as one break.
+    if (std::isnan(dots[first].y)) {
+      if (decimated.empty() || !std::isnan(decimated.back().y)) {
+        decimated.push_back(dots[first]);
+      }
+      ++first;
+      continue;
+    }
+    double column = column_of(dots[first]);
+    size_t last = first;
+    size_t lowest = first;
+    size_t highest = first;
+    while (last + 1 < dots.size() && !std::isnan(dots[last + 1].y) &&
+           column_of(dots[last + 1]) == column) {
+      ++last;
+      if (dots[last].y < dots[lowest].y) {
+        lowest = last;
+      }
+      if (dots[last].y > dots[highest].y) {
+        highest = last;
+      }
+    }
+    size_t kept[] = {first, std::min(lowest, highest),
+                     std::max(lowest, highest), last};
+    for (size_t i = 0; i < 4; ++i) {
+      if (i == 0 || kept[i] != kept[i - 1]) {
+        decimated.push_back(dots[kept[i]]);
+      }
+    }
+    first = last + 1;
+  }
+  dots.swap(decimated);
+}
+
+s21::Plot::Sampler::Sampler(std::shared_ptr<const Program> program,
+                            double from, double to, double x_scale,
+                            double y_scale, Interval window,
+                            size_t derivative, size_t budget,
+                            std::chrono::steady_clock::time_point deadline,
+                            const std::atomic<bool> *cancelled)
+    : evaluator_(std::move(program)),
+      cancelled_(cancelled),
+      from_(from),
+      to_(to),
+      x_scale_(x_scale),
+      y_scale_(y_scale),
+      window_(window),
+      derivative_(derivative),
+      budget_(budget),
+      deadline_(deadline) {}
+
+void s21::Plot::Sampler::CalculateDots() {
+  dots_.clear();
+  double intervals = std::max(1.0, std::ceil((to_ - from_) * x_scale_ /
+                                             kInitialStep));
+  double step = (to_ - from_) / intervals;
+  std::vector<Dot> grid;
+  grid.reserve(static_cast<size_t>(intervals) + 1);
+  for (double i = 0; i <= intervals && !IsCancelled(); ++i) {
+    grid.push_back(Sample(i == intervals ? to_ : from_ + step * i));
+  }
+  for (size_t i = 0; i < grid.size(); ++i) {
+    if (i > 0) {
+      Subdivide(grid[i - 1], grid[i], 0);
+    }
+    dots_.push_back(grid[i]);
+  }
+}
+
+s21::Dot s21::Plot::Sampler::Sample(double x) {
+  ++evaluations_;
+  double y = derivative_ ? evaluator_.EvaluateDual(x).Derivative(derivative_)
+                         : evaluator_.Evaluate(x);
+  return {x, std::isfinite(y) ? y : std::numeric_limits<double>::quiet_NaN()};
+}
+
+void s21::Plot::Sampler::Subdivide(const Dot &left, const Dot &right,
+                                   size_t depth) {
+  if (depth >= kMaxDepth || IsCancelled() || IsOutOfBudget() ||
+      IsSettled(left, right)) {
+    return;
+  }
+  Dot middle = Sample((left.x + right.x) / 2);
+  if (NeedsSubdivision(left, middle, right)) {
+    Subdivide(left, middle, depth + 1);
+    dots_.push_back(middle);
+    Subdivide(middle, right, depth + 1);
+  } else {
+    FindBreak(left, middle);
+    dots_.push_back(middle);
+    FindBreak(middle, right);
+  }
+}
+
+void s21::Plot::Sampler::FindBreak(const Dot &left, const Dot &right) {
+  bool edge = std::isnan(left.y) != std::isnan(right.y);
+  double jump = std::fabs(right.y - left.y);
+  if (!edge && !(jump * y_scale_ > kBreakHeight)) {
+    return;
+  }
+  Dot lower = left;
+  Dot upper = right;
+  for (size_t i = 0; i < kBreakBisections && !IsOutOfBudget(); ++i) {
+    Dot middle = Sample((lower.x + upper.x) / 2);
+    if (middle.x <= lower.x || middle.x >= upper.x) {
+      break;
+    }
+    bool go_left = edge ? std::isnan(middle.y) != std::isnan(lower.y)
+                        : std::fabs(middle.y - lower.y) >
+                              std::fabs(upper.y - middle.y);
+    (go_left ? upper : lower) = middle;
+  }
+  // A continuous curve would have flattened out over the bisections.
+  if (!edge && !(std::fabs(upper.y - lower.y) > jump / 2)) {
+    return;
+  }
+  if (lower.x > left.x && !std::isnan(lower.y)) {
+    dots_.push_back(lower);
+  }
+  dots_.push_back({(lower.x + upper.x) / 2,
+                   std::numeric_limits<double>::quiet_NaN()});
+  if (upper.x < right.x && !std::isnan(upper.y)) {
+    dots_.push_back(upper);
+  }
+}
+
+// Evaluations come one or two at a time, so the clock is read at the
+// first check past each period rather than at its exact multiples.
+bool s21::Plot::Sampler::IsOutOfBudget() {
+  if (partial_) {
+    return true;
+  }
+  if (evaluations_ >= budget_) {
+    partial_ = true;
+  } else if (evaluations_ >= next_deadline_check_) {
+    next_deadline_check_ = evaluations_ + kDeadlinePeriod;
+    partial_ = std::chrono::steady_clock::now() >= deadline_;
+  }
+  return partial_;
+}
+
+bool s21::Plot::Sampler::IsSettled(const Dot &left, const Dot &right) {
+  if (derivative_ || (right.x - left.x) * x_scale_ <= 1) {
+    return false;
+  }
+  ++evaluations_;
+  Interval bounds = evaluator_.EvaluateInterval({left.x, right.x});
+  if (bounds.IsEmpty() || bounds.lo > window_.hi || bounds.hi < window_.lo) {
+    return true;
+  }
+  // Any curve within the bounds stays close enough to the chord, unless
+  // an end lies outside of the domain and its edge is still to be found.
+  return std::isfinite(left.y) && std::isfinite(right.y) &&
+         (bounds.hi - bounds.lo) * y_scale_ <= kTolerance;
+}
+
+bool s21::Plot::Sampler::NeedsSubdivision(const Dot &left, const Dot &middle,
+                                          const Dot &right) const {
+  double width = (right.x - left.x) * x_scale_;
+  if (width < kMinStep) {
+    return false;
+  }
+  bool finite[] = {std::isfinite(left.y), std::isfinite(middle.y),
+                   std::isfinite(right.y)};
+  if (!finite[0] || !finite[1] || !finite[2]) {
+    // The edge of the domain is then located by FindBreak().
+    return (finite[0] || finite[1] || finite[2]) && width > 1;
+  }
+  // A turn wider than a pixel may hide an extremum the chord test misses.
+  if (width > 1 && (middle.y - left.y) * (right.y - middle.y) < 0) {
+    return true;
+  }
+  double height = (right.y - left.y) * y_scale_;
+  double offset = std::fabs(middle.y - (left.y + right.y) / 2) * y_scale_;
+  return offset * width > kTolerance * std::hypot(width, height);
+}
+
+s21::PlotJob::PlotJob(std::shared_ptr<const Program> program,
+                      std::vector<double> plot_limits)
+    : program_(std::move(program)), plot_limits_(std::move(plot_limits)) {
+  plot_.SetPlotLimits(plot_limits_);
+}
+
+bool s21::PlotJob::Run() {
+  preview_evaluations_ = 0;
+  plot_.SetBudget(budget_);
+  if (on_preview_ && program_ && program_->IsValid() &&
+      plot_.HasValidLimits()) {
+    std::vector<Dot> dots;
+    if (plot_.FindCoarserDots(program_, dots)) {
+      on_preview_(std::move(dots));
+    } else {
+      RunPreview();
+    }
+  }
+  if (preview_evaluations_) {
+    PlotBudget remaining = budget_;
+    remaining.max_evaluations = std::max<size_t>(
+        plot_.GetMaxEvaluations() - preview_evaluations_, 1);
+    plot_.SetBudget(remaining);
+  }
+  return plot_.CalculateDots(program_, &cancelled_, [this](double progress) {
+    progress_ = progress;
+    if (on_progress_) {
+      on_progress_(progress);
+    }
+  });
+}
+
+bool s21::PlotJob::Analyse() {
+  if (cancelled_ || !program_ || !program_->IsValid() ||
+      !plot_.HasValidLimits()) {
+    return !cancelled_;
+  }
+  if (!plot_.GetDerivative()) {
+    roots_ = RootFinder(program_).FindRoots(plot_limits_[0], plot_limits_[1]);
+  }
+  if (!cancelled_ && !plot_.IsPartial()) {
+    integral_ = Integrator(program_).Integrate(plot_limits_[0],
+                                               plot_limits_[1]);
+  }
+  return !cancelled_;
+}
+
+void s21::PlotJob::RunPreview() {
+  size_t preview_dots =
+      (plot_.GetWidth() + kPreviewStride - 1) / kPreviewStride * kPreviewStride;
+  double x_min = plot_limits_[0];
+  double x_step = (plot_limits_[1] - plot_limits_[0]) /
+                  static_cast<double>(preview_dots);
+  size_t derivative = plot_.GetDerivative();
+  size_t max_evaluations = plot_.GetMaxEvaluations();
+  Evaluator evaluator(program_);
+  std::vector<double> y_grid(preview_dots + 1);
+  std::vector<size_t> nodes;
+  std::vector<double> x_values;
+  std::vector<double> y_values;
+  for (size_t stride = kPreviewStride; stride > 1 && !cancelled_;
+       stride /= 2) {
+    nodes.clear();
+    for (size_t i = 0; i <= preview_dots; i += stride) {
+      if (stride == kPreviewStride || i % (stride * 2) != 0) {
+        nodes.push_back(i);
+      }
+    }
+    if (preview_evaluations_ + nodes.size() > max_evaluations) {
+      break;
+    }
+    preview_evaluations_ += nodes.size();
+    x_values.resize(nodes.size());
+    y_values.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      x_values[i] = x_min + x_step * static_cast<double>(nodes[i]);
+    }
+    if (derivative) {
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        Dual y = evaluator.EvaluateDual(x_values[i]);
+        y_values[i] = y.Derivative(derivative);
+      }
+    } else {
+      evaluator.EvaluateBatch(x_values.data(), y_values.data(), nodes.size());
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      y_grid[nodes[i]] = y_values[i];
+    }
+
+    std::vector<Dot> dots;
+    dots.reserve(preview_dots / stride + 1);
+    for (size_t i = 0; i <= preview_dots; i += stride) {
+      dots.push_back({x_min + x_step * static_cast<double>(i), y_grid[i]});
+    }
+    if (!cancelled_) {
+      on_preview_(std::move(dots));
+    }
+  }
+}
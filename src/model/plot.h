@@ -0,0 +1,306 @@
+#ifndef SRC_MODEL_PLOT_H_
+#define SRC_MODEL_PLOT_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "evaluator.h"
+#include "integral.h"
+#include "interval.h"
+#include "program.h"
+
+namespace s21 {
+
+// Layout matches QCPGraphData, so the view converts a whole buffer in one
+// pass.
+struct Dot {
+  double x;
+  double y;
+};
+
+// Limits on the refinement of one plot. Once either is reached the plot
+// keeps the dots sampled so far, which always include the initial grid,
+// and reports itself as partial. A zero max_evaluations stands for
+// Plot::kEvaluationsPerColumn per pixel column.
+struct PlotBudget {
+  std::chrono::steady_clock::duration time_limit{std::chrono::seconds(2)};
+  size_t max_evaluations{};
+};
+
+using ProgressCallback = std::function<void(double progress)>;
+using PreviewCallback = std::function<void(std::vector<Dot> dots)>;
+
+// Tiles split the X axis on a grid fixed in plot coordinates: at level L
+// the sampler resolves 2^L columns per unit and a tile spans
+// Plot::kTileColumns of them. The Y level quantizes the vertical scale in
+// the same way, since the refinement depends on it, and the bands give the
+// Y window outside of which the tile was left unrefined, in units of
+// Plot::kBandHeight rows. Derivative plots are cached under their order.
+struct TileKey {
+  std::shared_ptr<const Program> program;
+  int x_level;
+  int y_level;
+  int64_t index;
+  int64_t first_band;
+  int64_t last_band;
+  size_t derivative;
+
+  bool operator==(const TileKey &other) const {
+    return program == other.program && x_level == other.x_level &&
+           y_level == other.y_level && index == other.index &&
+           first_band == other.first_band && last_band == other.last_band &&
+           derivative == other.derivative;
+  }
+};
+
+struct TileKeyHash {
+  size_t operator()(const TileKey &key) const;
+};
+
+// Least recently used cache of sampled tiles, shared by the plots of a
+// model so that panning and zooming only sample what was not seen yet.
+// Safe to use from several threads.
+class TileCache {
+ public:
+  using Tile = std::shared_ptr<const std::vector<Dot>>;
+
+  explicit TileCache(size_t capacity) : capacity_(capacity) {}
+  Tile Find(const TileKey &key);
+  void Insert(const TileKey &key, Tile tile);
+  size_t GetHits() const;
+  size_t GetMisses() const;
+
+ private:
+  using Entry = std::pair<TileKey, Tile>;
+
+  void EvictExcess();
+
+  mutable std::mutex mutex_{};
+  size_t capacity_{};
+  size_t hits_{};
+  size_t misses_{};
+  std::list<Entry> entries_{};
+  std::unordered_map<TileKey, std::list<Entry>::iterator, TileKeyHash>
+      index_{};
+};  // class TileCache
+
+class Plot {
+ public:
+  // Width of a tile in sampled columns. Tiles are sampled concurrently and
+  // only complete ones are cached.
+  static constexpr size_t kTileColumns = 16;
+  // How many levels below the current one are searched for a preview.
+  static constexpr int kCoarserLevels = 4;
+  // Viewport used until SetViewport() is called, in device pixels.
+  static constexpr size_t kDefaultWidth = 290;
+  static constexpr size_t kDefaultHeight = 250;
+  // Default cap on the evaluations of one plot, split evenly between
+  // tiles.
+  static constexpr size_t kEvaluationsPerColumn = 64;
+  // The Y range is rounded outwards to bands of this many rows, plus one
+  // band of margin, before curve parts outside of it are culled.
+  static constexpr double kBandHeight = 256;
+
+  void SetPlotLimits(std::vector<double> plot_limits);
+  // The X range is sampled about once per pixel column, and the dots of a
+  // column are then reduced to its first, lowest, highest and last ones.
+  void SetViewport(size_t width, size_t height);
+  size_t GetWidth() const { return width_; }
+  // False for empty, inverted or non-finite ranges, and for ranges too
+  // narrow to be resolved at the viewport size. Such plots have no dots
+  // and are reported as partial.
+  bool HasValidLimits() const;
+  // Plots the first or second derivative of the program instead of its
+  // value when order is 1 or 2.
+  void SetDerivative(size_t order) { derivative_ = order; }
+  size_t GetDerivative() const { return derivative_; }
+  void SetBudget(PlotBudget budget) { budget_ = budget; }
+  size_t GetMaxEvaluations() const;
+  void SetTileCache(std::shared_ptr<TileCache> tiles) {
+    tiles_ = std::move(tiles);
+  }
+  size_t GetEvaluations() const { return evaluations_; }
+  // True when the last plot ran out of its budget before it was refined.
+  bool IsPartial() const { return partial_; }
+  // Returns false and leaves no dots when cancelled is set while sampling.
+  // An invalid program has no dots either, but is not partial.
+  // on_progress receives the sampled fraction of the X range.
+  bool CalculateDots(const std::shared_ptr<const Program> &program,
+                     const std::atomic<bool> *cancelled = nullptr,
+                     const ProgressCallback &on_progress = {});
+  // Assembles the range from cached tiles of a coarser level, if one of
+  // them covers all of it.
+  bool FindCoarserDots(const std::shared_ptr<const Program> &program,
+                       std::vector<Dot> &dots) const;
+  void Clear();
+
+  // Moves the sampled dots out, leaving the plot empty.
+  std::vector<Dot> TakeDots() { return std::move(dots_); }
+
+ private:
+  // Samples one tile of the X range with its own evaluator. The tile is
+  // first cut into intervals of kInitialStep columns, then each interval
+  // is halved for as long as its midpoint lies more than kTolerance
+  // pixels away from the chord between its ends, or the curve turns
+  // within a column wide or wider interval, down to kMinStep columns.
+  // Final intervals that cross the edge of the domain, or jump by more
+  // than kBreakHeight pixels, are bisected at most kBreakBisections times
+  // to locate the edge or the discontinuity, which is then marked by a
+  // NaN dot so that the curve is drawn in separate segments. Before an
+  // interval wider than a column is halved, f is bounded over it with
+  // interval arithmetic: it is left as a chord when the bounds lie outside
+  // of the window, or span no more than kTolerance pixels. Derivatives are
+  // sampled over dual numbers and have no such bounds.
+  class Sampler {
+   public:
+    static constexpr double kInitialStep = 8;
+    static constexpr double kMinStep = 1.0 / 64;
+    static constexpr double kTolerance = 0.25;
+    static constexpr size_t kMaxDepth = 24;
+    static constexpr double kBreakHeight = 32;
+    static constexpr size_t kBreakBisections = 32;
+
+    Sampler(std::shared_ptr<const Program> program, double from, double to,
+            double x_scale, double y_scale, Interval window,
+            size_t derivative, size_t budget,
+            std::chrono::steady_clock::time_point deadline,
+            const std::atomic<bool> *cancelled);
+
+    void CalculateDots();
+    std::vector<Dot> TakeDots() { return std::move(dots_); }
+    size_t GetEvaluations() const { return evaluations_; }
+    bool IsPartial() const { return partial_; }
+
+   private:
+    // The clock is read again after every kDeadlinePeriod evaluations.
+    static constexpr size_t kDeadlinePeriod = 64;
+
+    Dot Sample(double x);
+    void Subdivide(const Dot &left, const Dot &right, size_t depth);
+    void FindBreak(const Dot &left, const Dot &right);
+    bool NeedsSubdivision(const Dot &left, const Dot &middle,
+                          const Dot &right) const;
+    bool IsSettled(const Dot &left, const Dot &right);
+    bool IsCancelled() const { return cancelled_ && *cancelled_; }
+    bool IsOutOfBudget();
+
+    Evaluator evaluator_;
+    const std::atomic<bool> *cancelled_{};
+    double from_{};
+    double to_{};
+    double x_scale_{};
+    double y_scale_{};
+    Interval window_{};
+    size_t derivative_{};
+    size_t budget_{};
+    std::chrono::steady_clock::time_point deadline_{};
+    size_t evaluations_{};
+    size_t next_deadline_check_{};
+    bool partial_{};
+    std::vector<Dot> dots_{};
+  };  // class Sampler
+
+  double x_min_{};
+  double x_max_{};
+  double y_min_{};
+  double y_max_{};
+  size_t width_{kDefaultWidth};
+  size_t height_{kDefaultHeight};
+  size_t derivative_{};
+  PlotBudget budget_{};
+  std::shared_ptr<TileCache> tiles_{};
+  size_t evaluations_{};
+  bool partial_{};
+  std::vector<Dot> dots_{};
+
+  int GetXLevel() const;
+  int GetYLevel() const;
+  std::pair<int64_t, int64_t> GetBands(int y_level) const;
+  double GetTileWidth(int x_level) const;
+  int64_t GetFirstTile(int x_level) const;
+  int64_t GetLastTile(int x_level) const;
+  void Stitch(const std::vector<TileCache::Tile> &tiles,
+              std::vector<Dot> &dots) const;
+  void Decimate(std::vector<Dot> &dots) const;
+};  // class Plot
+
+// A plot sampled away from the thread that requested it. Cancel() and
+// GetProgress() may be called from any thread while Run() is in progress.
+class PlotJob {
+ public:
+  // Before the full pass the range is drawn from cached coarser tiles when
+  // possible. Otherwise it is sampled uniformly on a grid of one interval
+  // per pixel column, first at every kPreviewStride-th node and then at
+  // twice the density per level down to every second node, evaluating
+  // only the nodes a level adds. The preview evaluations count against
+  // the budget, and the full pass gets what they leave of it.
+  static constexpr size_t kPreviewStride = 8;
+
+  PlotJob(std::shared_ptr<const Program> program,
+          std::vector<double> plot_limits);
+
+  void SetProgressCallback(ProgressCallback on_progress) {
+    on_progress_ = std::move(on_progress);
+  }
+  void SetViewport(size_t width, size_t height) {
+    plot_.SetViewport(width, height);
+  }
+  void SetDerivative(size_t order) { plot_.SetDerivative(order); }
+  void SetBudget(PlotBudget budget) {
+    budget_ = budget;
+    plot_.SetBudget(budget);
+  }
+  void SetTileCache(std::shared_ptr<TileCache> tiles) {
+    plot_.SetTileCache(std::move(tiles));
+  }
+  // Receives each coarse preview, from the coarsest to the finest one.
+  void SetPreviewCallback(PreviewCallback on_preview) {
+    on_preview_ = std::move(on_preview);
+  }
+  // Returns false when the job was cancelled before the dots were ready.
+  bool Run();
+  // Run after Run() on the same thread: finds the roots on the X range,
+  // unless a derivative is plotted, and the integral over it, unless the
+  // plot is partial. Returns false when cancelled in between.
+  bool Analyse();
+  const std::vector<double> &GetRoots() const { return roots_; }
+  Integral GetIntegral() const { return integral_; }
+  void Cancel() { cancelled_ = true; }
+  bool IsCancelled() const { return cancelled_; }
+  double GetProgress() const { return progress_; }
+  size_t GetEvaluations() const {
+    return preview_evaluations_ + plot_.GetEvaluations();
+  }
+  bool IsPartial() const { return plot_.IsPartial(); }
+  const std::vector<double> &GetPlotLimits() const { return plot_limits_; }
+  std::vector<Dot> TakeDots() { return plot_.TakeDots(); }
+
+ private:
+  Plot plot_;
+  std::shared_ptr<const Program> program_{};
+  std::vector<double> plot_limits_{};
+  PlotBudget budget_{};
+  size_t preview_evaluations_{};
+  std::vector<double> roots_{};
+  Integral integral_{std::numeric_limits<double>::quiet_NaN(),
+                     std::numeric_limits<double>::quiet_NaN()};
+  ProgressCallback on_progress_{};
+  PreviewCallback on_preview_{};
+  std::atomic<bool> cancelled_{};
+  std::atomic<double> progress_{};
+
+  void RunPreview();
+};  // class PlotJob
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_PLOT_H_
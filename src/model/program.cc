@@ -0,0 +1,37 @@
+#include "program.h"
+
+s21::Register s21::Program::AddConstant(double value) {
+  registers_.push_back(value);
+  return static_cast<Register>(registers_.size() - 1);
+}
+
+s21::Register s21::Program::AddRegister() { return AddConstant(0.0); }
+
+s21::Register s21::Program::AddParameter(double value) {
+  parameters_.push_back(AddConstant(value));
+  return parameters_.back();
+}
+
+void s21::Program::Emit(OpCode code, Register dst, Register lhs,
+                        Register rhs, Register addend) {
+  instructions_.push_back({code, dst, lhs, rhs, addend});
+}
+
+void s21::Program::EmitInvariant(OpCode code, Register dst, Register lhs,
+                                 Register rhs, Register addend) {
+  invariant_instructions_.push_back({code, dst, lhs, rhs, addend});
+}
+
+void s21::Program::SetError(size_t position) {
+  error_position_ = position;
+  instructions_.clear();
+  invariant_instructions_.clear();
+  registers_.resize(1);
+  parameters_.clear();
+  result_ = kXRegister;
+}
+
+bool s21::Program::IsCompiled() const {
+  std::lock_guard<std::mutex> lock(native_->mutex);
+  return native_->code != nullptr;
+}
@@ -0,0 +1,100 @@
+#ifndef SRC_MODEL_PROGRAM_H_
+#define SRC_MODEL_PROGRAM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace s21 {
+
+class JitCode;
+
+enum class OpCode : uint8_t {
+  kNeg, kSqrt, kLn, kLog10,
+  kSin, kCos, kTan,
+  kArcSin, kArcCos, kArcTan, kSinCos,
+  kAdd, kSub, kMul, kDiv, kMod, kPow,
+  kFma
+};  // enum class OpCode
+
+constexpr size_t kOpCodeCount = static_cast<size_t>(OpCode::kFma) + 1;
+
+using Register = uint32_t;
+
+// kSinCos stores sin(lhs) to dst and cos(lhs) to rhs, which is an output
+// register of that instruction instead of an operand. kFma stores
+// lhs * rhs + addend, rounded once, to dst; no other opcode reads addend.
+struct Instruction {
+  OpCode code{};
+  Register dst{};
+  Register lhs{};
+  Register rhs{};
+  Register addend{};
+};  // struct Instruction
+
+// Compiled form of an expression. Every value lives in a register: the
+// register file holds X, the parameters, the literals of the expression
+// and the temporaries, all laid out at compile time, so evaluation never
+// allocates. Parameters are inputs held fixed while X varies. Instructions
+// that do not depend on X form a separate invariant section: an evaluator
+// runs it once when it loads the program or a parameter changes, and the
+// per-sample instructions read its results like constants.
+class Program {
+ public:
+  static constexpr Register kXRegister = 0;
+
+  // JIT state shared by every evaluator of the program: the samples they
+  // have evaluated so far, and the native code compiled once by the first
+  // of them to see those reach the threshold (see Evaluator).
+  struct NativeCode {
+    std::atomic<size_t> samples{};
+    std::mutex mutex{};
+    bool compiled{};
+    std::shared_ptr<const JitCode> code{};
+  };
+
+  Program() : registers_{0.0} {}
+
+  Register AddConstant(double value);
+  Register AddRegister();
+  Register AddParameter(double value);
+  void Emit(OpCode code, Register dst, Register lhs, Register rhs = 0,
+            Register addend = 0);
+  void EmitInvariant(OpCode code, Register dst, Register lhs,
+                     Register rhs = 0, Register addend = 0);
+  void SetResult(Register result) { result_ = result; }
+  void SetError(size_t position);
+
+  bool IsValid() const { return error_position_ == std::string::npos; }
+  size_t GetErrorPosition() const { return error_position_; }
+  Register GetResult() const { return result_; }
+  const std::vector<Instruction> &GetInstructions() const {
+    return instructions_;
+  }
+  const std::vector<Instruction> &GetInvariantInstructions() const {
+    return invariant_instructions_;
+  }
+  const std::vector<double> &GetRegisters() const { return registers_; }
+  const std::vector<Register> &GetParameters() const { return parameters_; }
+  NativeCode &GetNativeCode() const { return *native_; }
+  bool IsCompiled() const;
+
+  static bool IsUnary(OpCode code) { return code < OpCode::kAdd; }
+
+ private:
+  std::vector<Instruction> instructions_{};
+  std::vector<Instruction> invariant_instructions_{};
+  std::vector<double> registers_{};
+  std::vector<Register> parameters_{};
+  std::unique_ptr<NativeCode> native_{std::make_unique<NativeCode>()};
+  Register result_{kXRegister};
+  size_t error_position_{std::string::npos};
+};  // class Program
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_PROGRAM_H_
@@ -0,0 +1,89 @@
+#include "roots.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+
+#include "thread_pool.h"
+
+std::vector<double> s21::RootFinder::FindRoots(double x_min,
+                                               double x_max) const {
+  std::vector<double> roots;
+  if (!program_ || !program_->IsValid() || !(x_min < x_max)) {
+    return roots;
+  }
+  std::vector<double> x(kGridIntervals + 1);
+  std::vector<double> y(x.size());
+  double step = (x_max - x_min) / kGridIntervals;
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = i == kGridIntervals ? x_max
+                               : x_min + step * static_cast<double>(i);
+  }
+  Evaluator(program_).EvaluateBatch(x.data(), y.data(), x.size());
+
+  std::vector<Bracket> brackets;
+  for (size_t i = 0; i < x.size(); ++i) {
+    if (y[i] == 0) {
+      roots.push_back(x[i]);
+    } else if (i > 0 && std::isfinite(y[i - 1]) && std::isfinite(y[i]) &&
+               std::signbit(y[i - 1]) != std::signbit(y[i]) && y[i - 1] != 0) {
+      brackets.push_back({x[i - 1], x[i], y[i - 1], y[i]});
+    }
+  }
+
+  ThreadPool &pool = ThreadPool::Shared();
+  size_t groups = std::min(brackets.size(), pool.GetThreadCount());
+  std::vector<std::future<std::vector<double>>> refined;
+  for (size_t group = 0; group < groups; ++group) {
+    refined.push_back(pool.Submit([&, group]() {
+      Evaluator evaluator(program_);
+      std::vector<double> found;
+      for (size_t i = group; i < brackets.size(); i += groups) {
+        double root = 0;
+        if (Refine(evaluator, brackets[i], root)) {
+          found.push_back(root);
+        }
+      }
+      return found;
+    }));
+  }
+  for (std::future<std::vector<double>> &found : refined) {
+    std::vector<double> group = found.get();
+    roots.insert(roots.end(), group.begin(), group.end());
+  }
+  std::sort(roots.begin(), roots.end());
+  return roots;
+}
+
+bool s21::RootFinder::Refine(Evaluator &evaluator, const Bracket &bracket,
+                             double &root) {
+  // Orient the bracket so that f(negative) < 0 < f(positive).
+  double negative = bracket.f_lo < 0 ? bracket.lo : bracket.hi;
+  double positive = bracket.f_lo < 0 ? bracket.hi : bracket.lo;
+  double x = (bracket.lo + bracket.hi) / 2;
+  double previous_step = std::fabs(bracket.hi - bracket.lo);
+  Dual f = evaluator.EvaluateDual(x);
+  for (size_t i = 0; i < kMaxIterations && f.value != 0; ++i) {
+    if (std::isnan(f.value)) {
+      return false;
+    }
+    (f.value < 0 ? negative : positive) = x;
+    double lo = std::min(negative, positive);
+    double hi = std::max(negative, positive);
+    double next = x - f.value / f.first;
+    if (!(next > lo && next < hi) ||
+        std::fabs(2 * f.value) > std::fabs(previous_step * f.first)) {
+      next = lo + (hi - lo) / 2;
+    }
+    previous_step = std::fabs(next - x);
+    if (next == x || next <= lo || next >= hi) {
+      break;
+    }
+    x = next;
+    f = evaluator.EvaluateDual(x);
+  }
+  root = x;
+  return std::fabs(f.value) <=
+         std::min(std::fabs(bracket.f_lo), std::fabs(bracket.f_hi));
+}
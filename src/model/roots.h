@@ -0,0 +1,47 @@
+#ifndef SRC_MODEL_ROOTS_H_
+#define SRC_MODEL_ROOTS_H_
+
+#include <memory>
+#include <vector>
+
+#include "evaluator.h"
+#include "program.h"
+
+namespace s21 {
+
+// Finds the zeros of a program where it changes sign. The range is first
+// evaluated in one batch on a grid of kGridIntervals intervals; every
+// interval whose ends have opposite signs is then refined by Newton steps
+// on dual numbers, falling back to bisection whenever a step would leave
+// the bracket or shrink it too slowly. Brackets are refined in parallel on
+// the shared thread pool. A bracket around a pole also changes sign, so a
+// refined point is kept only if f is no larger there than at the ends of
+// its bracket.
+class RootFinder {
+ public:
+  static constexpr size_t kGridIntervals = 1024;
+  static constexpr size_t kMaxIterations = 100;
+
+  explicit RootFinder(std::shared_ptr<const Program> program)
+      : program_(std::move(program)) {}
+
+  // Roots in [x_min, x_max] in increasing order.
+  std::vector<double> FindRoots(double x_min, double x_max) const;
+
+ private:
+  struct Bracket {
+    double lo;
+    double hi;
+    double f_lo;
+    double f_hi;
+  };
+
+  static bool Refine(Evaluator &evaluator, const Bracket &bracket,
+                     double &root);
+
+  std::shared_ptr<const Program> program_{};
+};  // class RootFinder
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_ROOTS_H_
@@ -0,0 +1,271 @@
+#include "simd_kernels.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define S21_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#define S21_SIMD_INLINE inline __attribute__((always_inline))
+
+namespace {
+
+namespace scalar {
+
+struct Kernels {
+  static void Neg(double *dst, const double *lhs, const double *,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = -lhs[i];
+    }
+  }
+  static void Sqrt(double *dst, const double *lhs, const double *,
+                   size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::sqrt(lhs[i]);
+    }
+  }
+  static void Ln(double *dst, const double *lhs, const double *,
+                 size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::log(lhs[i]);
+    }
+  }
+  static void Log10(double *dst, const double *lhs, const double *,
+                    size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::log10(lhs[i]);
+    }
+  }
+  static void Sin(double *dst, const double *lhs, const double *,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::sin(lhs[i]);
+    }
+  }
+  static void Cos(double *dst, const double *lhs, const double *,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::cos(lhs[i]);
+    }
+  }
+  static void Tan(double *dst, const double *lhs, const double *,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::tan(lhs[i]);
+    }
+  }
+  // GCC and Clang merge the two calls into one sincos().
+  static void SinCos(double *sin, double *cos, const double *x,
+                     size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      double value = x[i];
+      sin[i] = std::sin(value);
+      cos[i] = std::cos(value);
+    }
+  }
+  static void Fma(double *dst, const double *lhs, const double *rhs,
+                  const double *addend, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::fma(lhs[i], rhs[i], addend[i]);
+    }
+  }
+  static void ArcSin(double *dst, const double *lhs, const double *,
+                     size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::asin(lhs[i]);
+    }
+  }
+  static void ArcCos(double *dst, const double *lhs, const double *,
+                     size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::acos(lhs[i]);
+    }
+  }
+  static void ArcTan(double *dst, const double *lhs, const double *,
+                     size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::atan(lhs[i]);
+    }
+  }
+  static void Add(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = lhs[i] + rhs[i];
+    }
+  }
+  static void Sub(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = lhs[i] - rhs[i];
+    }
+  }
+  static void Mul(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = lhs[i] * rhs[i];
+    }
+  }
+  static void Div(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = lhs[i] / rhs[i];
+    }
+  }
+  static void Mod(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::fmod(lhs[i], rhs[i]);
+    }
+  }
+  static void Pow(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::pow(lhs[i], rhs[i]);
+    }
+  }
+};  // struct Kernels
+
+}  // namespace scalar
+
+#if defined(S21_SIMD_X86)
+
+namespace sse2 {
+typedef double Vec __attribute__((vector_size(16)));
+typedef decltype(Vec{} < Vec{}) Mask;
+constexpr int kLanes = 2;
+
+S21_SIMD_INLINE Vec Sqrt(Vec x) { return (Vec)_mm_sqrt_pd((__m128d)x); }
+// SSE2 has no fused multiply-add; libm picks the FMA instruction at run
+// time where the processor has one.
+S21_SIMD_INLINE Vec MulAdd(Vec a, Vec b, Vec c) {
+  return Vec{std::fma(a[0], b[0], c[0]), std::fma(a[1], b[1], c[1])};
+}
+
+#include "simd_kernels_impl.h"
+}  // namespace sse2
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace avx2 {
+typedef double Vec __attribute__((vector_size(32)));
+typedef decltype(Vec{} < Vec{}) Mask;
+constexpr int kLanes = 4;
+
+S21_SIMD_INLINE Vec Sqrt(Vec x) { return (Vec)_mm256_sqrt_pd((__m256d)x); }
+S21_SIMD_INLINE Vec MulAdd(Vec a, Vec b, Vec c) {
+  return (Vec)_mm256_fmadd_pd((__m256d)a, (__m256d)b, (__m256d)c);
+}
+
+#include "simd_kernels_impl.h"
+}  // namespace avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("avx512f"))), \
+                             apply_to = function)
+#else
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+namespace avx512 {
+typedef double Vec __attribute__((vector_size(64)));
+typedef decltype(Vec{} < Vec{}) Mask;
+constexpr int kLanes = 8;
+
+// The unmasked _mm512_sqrt_pd trips -Wmaybe-uninitialized in GCC headers.
+S21_SIMD_INLINE Vec Sqrt(Vec x) {
+  return (Vec)_mm512_maskz_sqrt_pd(0xff, (__m512d)x);
+}
+S21_SIMD_INLINE Vec MulAdd(Vec a, Vec b, Vec c) {
+  return (Vec)_mm512_fmadd_pd((__m512d)a, (__m512d)b, (__m512d)c);
+}
+
+#include "simd_kernels_impl.h"
+}  // namespace avx512
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif  // S21_SIMD_X86
+
+template <typename Kernels>
+s21::KernelSet MakeKernelSet(const char *name) {
+  s21::KernelSet kernels(name);
+  kernels.Set(s21::OpCode::kNeg, Kernels::Neg);
+  kernels.Set(s21::OpCode::kSqrt, Kernels::Sqrt);
+  kernels.Set(s21::OpCode::kLn, Kernels::Ln);
+  kernels.Set(s21::OpCode::kLog10, Kernels::Log10);
+  kernels.Set(s21::OpCode::kSin, Kernels::Sin);
+  kernels.Set(s21::OpCode::kCos, Kernels::Cos);
+  kernels.Set(s21::OpCode::kTan, Kernels::Tan);
+  kernels.Set(s21::OpCode::kArcSin, Kernels::ArcSin);
+  kernels.Set(s21::OpCode::kArcCos, Kernels::ArcCos);
+  kernels.Set(s21::OpCode::kArcTan, Kernels::ArcTan);
+  kernels.Set(s21::OpCode::kAdd, Kernels::Add);
+  kernels.Set(s21::OpCode::kSub, Kernels::Sub);
+  kernels.Set(s21::OpCode::kMul, Kernels::Mul);
+  kernels.Set(s21::OpCode::kDiv, Kernels::Div);
+  kernels.Set(s21::OpCode::kMod, Kernels::Mod);
+  kernels.Set(s21::OpCode::kPow, Kernels::Pow);
+  kernels.SetSinCos(Kernels::SinCos);
+  kernels.SetFma(Kernels::Fma);
+  return kernels;
+}
+
+}  // namespace
+
+const s21::KernelSet &s21::ScalarKernels() {
+  static const KernelSet kernels = MakeKernelSet<scalar::Kernels>("scalar");
+  return kernels;
+}
+
+std::vector<const s21::KernelSet *> s21::SupportedKernels() {
+  std::vector<const KernelSet *> supported = {&ScalarKernels()};
+#if defined(S21_SIMD_X86)
+  static const KernelSet sse2_kernels = MakeKernelSet<sse2::Kernels>("sse2");
+  static const KernelSet avx2_kernels = MakeKernelSet<avx2::Kernels>("avx2");
+  static const KernelSet avx512_kernels =
+      MakeKernelSet<avx512::Kernels>("avx512");
+  __builtin_cpu_init();
+  supported.push_back(&sse2_kernels);
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    supported.push_back(&avx2_kernels);
+    if (__builtin_cpu_supports("avx512f")) {
+      supported.push_back(&avx512_kernels);
+    }
+  }
+#endif
+  return supported;
+}
+
+const s21::KernelSet &s21::SelectKernels(const char *requested) {
+  std::vector<const KernelSet *> supported = SupportedKernels();
+  if (requested) {
+    for (const KernelSet *kernels : supported) {
+      if (std::strcmp(kernels->GetName(), requested) == 0) {
+        return *kernels;
+      }
+    }
+  }
+  return *supported.back();
+}
+
+const s21::KernelSet &s21::DefaultKernels() {
+  static const KernelSet &kernels = SelectKernels(std::getenv(kKernelsEnv));
+  return kernels;
+}
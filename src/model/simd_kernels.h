@@ -0,0 +1,78 @@
+#ifndef SRC_MODEL_SIMD_KERNELS_H_
+#define SRC_MODEL_SIMD_KERNELS_H_
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "program.h"
+
+namespace s21 {
+
+using Kernel = void (*)(double *dst, const double *lhs, const double *rhs,
+                        size_t count);
+using PairKernel = void (*)(double *sin, double *cos, const double *x,
+                            size_t count);
+using FmaKernel = void (*)(double *dst, const double *lhs, const double *rhs,
+                           const double *addend, size_t count);
+
+// Block kernels for every opcode, one table per instruction set: "scalar",
+// "sse2", "avx2" (with FMA) and "avx512" (AVX-512F). The
+// vectorized tables agree with libm to within the following errors,
+// measured in units in the last place of the libm result:
+//
+//   neg, add, sub, mul, div, sqrt,  0 ulp (correctly rounded)
+//   fma
+//   mod, pow                        0 ulp (evaluated per lane with libm)
+//   sin, cos, sincos                1 ulp for |x| <= 10, 2 ulp for
+//                                   |x| <= 2^19
+//   tan                             3 ulp for |x| <= 2^19
+//   ln                              1 ulp
+//   log10                           2 ulp
+//   atan                            1 ulp
+//   asin, acos                      2 ulp
+//
+// Arguments outside of the ranges above, as well as zeros, subnormals,
+// infinities and NaNs, are passed on to libm lane by lane. The sincos
+// kernel of kSinCos shares one range reduction between both results, which
+// are identical to those of the sin and cos kernels. The three-operand
+// kFma has a slot of its own as well.
+class KernelSet {
+ public:
+  explicit KernelSet(const char *name) : name_(name) {}
+
+  const char *GetName() const { return name_; }
+  Kernel Get(OpCode code) const {
+    return kernels_[static_cast<size_t>(code)];
+  }
+  void Set(OpCode code, Kernel kernel) {
+    kernels_[static_cast<size_t>(code)] = kernel;
+  }
+  PairKernel GetSinCos() const { return sincos_; }
+  void SetSinCos(PairKernel kernel) { sincos_ = kernel; }
+  FmaKernel GetFma() const { return fma_; }
+  void SetFma(FmaKernel kernel) { fma_ = kernel; }
+
+ private:
+  const char *name_{};
+  std::array<Kernel, kOpCodeCount> kernels_{};
+  PairKernel sincos_{};
+  FmaKernel fma_{};
+};  // class KernelSet
+
+// Environment variable naming the table to use instead of the widest one
+// the processor supports, for example SMARTCALC_SIMD=sse2.
+constexpr const char *kKernelsEnv = "SMARTCALC_SIMD";
+
+const KernelSet &ScalarKernels();
+// Tables usable on this processor, from the narrowest to the widest.
+std::vector<const KernelSet *> SupportedKernels();
+// The supported table with the requested name, or the widest one when the
+// name is null, unknown or not supported here.
+const KernelSet &SelectKernels(const char *requested);
+// Table chosen once at startup from the processor features and kKernelsEnv.
+const KernelSet &DefaultKernels();
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_SIMD_KERNELS_H_
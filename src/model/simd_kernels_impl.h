@@ -0,0 +1,472 @@
+// Body of the vectorized block kernels. simd_kernels.cc includes this file
+// once per instruction set, inside a namespace that defines the vector type
+// Vec, its comparison mask type Mask, the lane count kLanes, Sqrt(Vec) and
+// the fused MulAdd(Vec, Vec, Vec), and with the matching target options in
+// effect. There is deliberately no include guard, and nothing here may
+// instantiate a standard library template, since such an instantiation
+// could be shared with code compiled for a narrower instruction set.
+
+constexpr double kTwoOverPi = 6.36619772367581382433e-01;
+constexpr double kPiOver2Part1 = 1.57079632673412561417e+00;
+constexpr double kPiOver2Part2 = 6.07710050630396597660e-11;
+constexpr double kPiOver2Part3 = 2.02226624871116645580e-21;
+constexpr double kPiOver2Part4 = 8.47842766036889956997e-32;
+constexpr double kTrigMax = 524288.0;
+constexpr double kTrigTiny = 7.450580596923828125e-09;
+
+constexpr double kSin1 = -1.66666666666666324348e-01;
+constexpr double kSin2 = 8.33333333332248946124e-03;
+constexpr double kSin3 = -1.98412698298579493134e-04;
+constexpr double kSin4 = 2.75573137070700676789e-06;
+constexpr double kSin5 = -2.50507602534068634195e-08;
+constexpr double kSin6 = 1.58969099521155010221e-10;
+
+constexpr double kCos1 = 4.16666666666666019037e-02;
+constexpr double kCos2 = -1.38888888888741095749e-03;
+constexpr double kCos3 = 2.48015872894767294178e-05;
+constexpr double kCos4 = -2.75573143513906633035e-07;
+constexpr double kCos5 = 2.08757232129817482790e-09;
+constexpr double kCos6 = -1.13596475577881948265e-11;
+
+constexpr double kLn2High = 6.93147180369123816490e-01;
+constexpr double kLn2Low = 1.90821492927058770002e-10;
+constexpr double kLog10Of2High = 3.01029995663611771306e-01;
+constexpr double kLog10Of2Low = 3.69423907715893078616e-13;
+constexpr double kInvLn10 = 4.34294481903251816668e-01;
+constexpr double kSqrt2 = 1.41421356237309504880;
+constexpr double kMinNormal = 2.2250738585072014e-308;
+constexpr double kMaxFinite = 1.7976931348623157e+308;
+
+constexpr double kLg1 = 6.666666666666735130e-01;
+constexpr double kLg2 = 3.999999999940941908e-01;
+constexpr double kLg3 = 2.857142874366239149e-01;
+constexpr double kLg4 = 2.222219843214978396e-01;
+constexpr double kLg5 = 1.818357216161805012e-01;
+constexpr double kLg6 = 1.531383769920937332e-01;
+constexpr double kLg7 = 1.479819860511658591e-01;
+
+constexpr double kPiOver2 = 1.57079632679489661923;
+constexpr double kPiOver4 = 7.85398163397448309616e-01;
+constexpr double kTan3PiOver8 = 2.41421356237309504880;
+constexpr double kMoreBits = 6.123233995736765886130e-17;
+
+constexpr double kAtanP0 = -8.750608600031904122785e-01;
+constexpr double kAtanP1 = -1.615753718733365076637e+01;
+constexpr double kAtanP2 = -7.500855792314704667340e+01;
+constexpr double kAtanP3 = -1.228866684490136173410e+02;
+constexpr double kAtanP4 = -6.485021904942025371773e+01;
+constexpr double kAtanQ0 = 2.485846490142306297962e+01;
+constexpr double kAtanQ1 = 1.650270098316988542046e+02;
+constexpr double kAtanQ2 = 4.328810604912902668951e+02;
+constexpr double kAtanQ3 = 4.853903996359136964868e+02;
+constexpr double kAtanQ4 = 1.945506571482613964425e+02;
+
+// 1.5 * 2^52: adding it rounds a double below 2^51 in magnitude to an
+// integer, which can then be read from the low bits of the sum.
+constexpr double kRoundMagic = 6755399441055744.0;
+constexpr long long kRoundMagicBits = 0x4338000000000000LL;
+constexpr long long kSignBit = -0x7fffffffffffffffLL - 1;
+constexpr long long kMantissaBits = 0x000fffffffffffffLL;
+constexpr long long kOneBits = 0x3ff0000000000000LL;
+
+S21_SIMD_INLINE Vec Splat(double value) { return Vec{} + value; }
+
+S21_SIMD_INLINE Vec Select(Mask mask, Vec if_true, Vec if_false) {
+  return (Vec)((mask & (Mask)if_true) | (~mask & (Mask)if_false));
+}
+
+S21_SIMD_INLINE Mask SignOf(Vec x) { return (Mask)x & kSignBit; }
+
+S21_SIMD_INLINE Vec Abs(Vec x) { return (Vec)((Mask)x & ~kSignBit); }
+
+S21_SIMD_INLINE Vec Xor(Vec x, Mask bits) { return (Vec)((Mask)x ^ bits); }
+
+S21_SIMD_INLINE Vec ToDouble(Mask small_integer) {
+  return (Vec)(small_integer + kRoundMagicBits) - kRoundMagic;
+}
+
+S21_SIMD_INLINE bool Any(Mask mask) {
+  for (int lane = 0; lane < kLanes; ++lane) {
+    if (mask[lane]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reduces x to r in [-pi/4, pi/4] with x = r + q * pi/2 and evaluates the
+// sine and cosine of r. Exact for |x| <= kTrigMax up to the final rounding.
+S21_SIMD_INLINE void SinCosReduced(Vec x, Vec *sin_r, Vec *cos_r,
+                                   Mask *quadrant) {
+  Vec shifted = x * kTwoOverPi + kRoundMagic;
+  Vec q = shifted - kRoundMagic;
+  *quadrant = (Mask)shifted & 3;
+  Vec r = x - q * kPiOver2Part1;
+  r = r - q * kPiOver2Part2;
+  r = r - q * kPiOver2Part3;
+  r = r - q * kPiOver2Part4;
+
+  Vec z = r * r;
+  Vec sin_poly = kSin2 + z * (kSin3 + z * (kSin4 + z * (kSin5 + z * kSin6)));
+  *sin_r = r + z * r * (kSin1 + z * sin_poly);
+
+  Vec cos_poly =
+      z * (kCos1 +
+           z * (kCos2 + z * (kCos3 + z * (kCos4 + z * (kCos5 + z * kCos6)))));
+  Vec half_z = 0.5 * z;
+  Vec w = 1.0 - half_z;
+  *cos_r = w + (((1.0 - w) - half_z) + z * cos_poly);
+}
+
+S21_SIMD_INLINE Vec Sin(Vec x) {
+  Vec sin_r, cos_r;
+  Mask quadrant;
+  SinCosReduced(x, &sin_r, &cos_r, &quadrant);
+  Vec y = Select((quadrant & 1) != 0, cos_r, sin_r);
+  y = Xor(y, (quadrant & 2) << 62);
+  return Select(Abs(x) < Splat(kTrigTiny), x, y);
+}
+
+S21_SIMD_INLINE Vec Cos(Vec x) {
+  Vec sin_r, cos_r;
+  Mask quadrant;
+  SinCosReduced(x, &sin_r, &cos_r, &quadrant);
+  Vec y = Select((quadrant & 1) != 0, sin_r, cos_r);
+  return Xor(y, ((quadrant + 1) & 2) << 62);
+}
+
+S21_SIMD_INLINE void SinCos(Vec x, Vec *sin, Vec *cos) {
+  Vec sin_r, cos_r;
+  Mask quadrant;
+  SinCosReduced(x, &sin_r, &cos_r, &quadrant);
+  Mask odd = (quadrant & 1) != 0;
+  Vec y = Xor(Select(odd, cos_r, sin_r), (quadrant & 2) << 62);
+  *sin = Select(Abs(x) < Splat(kTrigTiny), x, y);
+  *cos = Xor(Select(odd, sin_r, cos_r), ((quadrant + 1) & 2) << 62);
+}
+
+S21_SIMD_INLINE Vec Tan(Vec x) {
+  Vec sin_r, cos_r;
+  Mask quadrant;
+  SinCosReduced(x, &sin_r, &cos_r, &quadrant);
+  Mask odd = (quadrant & 1) != 0;
+  Vec y = Select(odd, -cos_r, sin_r) / Select(odd, sin_r, cos_r);
+  return Select(Abs(x) < Splat(kTrigTiny), x, y);
+}
+
+// Splits a positive normal x into 2^k * (1 + f) with 1 + f in
+// [sqrt(2)/2, sqrt(2)) and returns log(1 + f) without the k * ln(2) term.
+S21_SIMD_INLINE Vec LogReduced(Vec x, Vec *k, Vec *f, Vec *half_f_squared,
+                               Vec *correction) {
+  Mask bits = (Mask)x;
+  Mask exponent = ((bits >> 52) & 0x7ff) - 1023;
+  Vec m = (Vec)((bits & kMantissaBits) | kOneBits);
+  Mask above = m > Splat(kSqrt2);
+  m = Select(above, 0.5 * m, m);
+  *k = ToDouble(exponent - above);
+
+  *f = m - 1.0;
+  Vec s = *f / (2.0 + *f);
+  Vec z = s * s;
+  Vec w = z * z;
+  Vec t1 = w * (kLg2 + w * (kLg4 + w * kLg6));
+  Vec t2 = z * (kLg1 + w * (kLg3 + w * (kLg5 + w * kLg7)));
+  *half_f_squared = 0.5 * *f * *f;
+  *correction = s * (*half_f_squared + t1 + t2);
+  return *f - (*half_f_squared - *correction);
+}
+
+S21_SIMD_INLINE Vec Ln(Vec x) {
+  Vec k, f, half_f_squared, correction;
+  LogReduced(x, &k, &f, &half_f_squared, &correction);
+  return k * kLn2High -
+         ((half_f_squared - (correction + k * kLn2Low)) - f);
+}
+
+S21_SIMD_INLINE Vec Log10(Vec x) {
+  Vec k, f, half_f_squared, correction;
+  Vec log_m = LogReduced(x, &k, &f, &half_f_squared, &correction);
+  return k * kLog10Of2High + (k * kLog10Of2Low + log_m * kInvLn10);
+}
+
+S21_SIMD_INLINE Vec Atan(Vec x) {
+  Mask sign = SignOf(x);
+  Vec a = Abs(x);
+  Mask big = a > Splat(kTan3PiOver8);
+  Mask middle = (a > Splat(0.66)) & ~big;
+  Vec reduced =
+      Select(big, -1.0 / a, Select(middle, (a - 1.0) / (a + 1.0), a));
+  Vec base = Select(big, Splat(kPiOver2),
+                    Select(middle, Splat(kPiOver4), Splat(0.0)));
+  Vec more = Select(big, Splat(kMoreBits),
+                    Select(middle, Splat(0.5 * kMoreBits), Splat(0.0)));
+
+  Vec z = reduced * reduced;
+  Vec p = (((kAtanP0 * z + kAtanP1) * z + kAtanP2) * z + kAtanP3) * z +
+          kAtanP4;
+  Vec q = ((((z + kAtanQ0) * z + kAtanQ1) * z + kAtanQ2) * z + kAtanQ3) * z +
+          kAtanQ4;
+  Vec y = reduced * (z * p / q) + reduced;
+  return Xor(base + (y + more), sign);
+}
+
+S21_SIMD_INLINE Vec ArcSin(Vec x) {
+  return Atan(x / Sqrt((1.0 - x) * (1.0 + x)));
+}
+
+S21_SIMD_INLINE Vec ArcCos(Vec x) {
+  return 2.0 * Atan(Sqrt((1.0 - x) / (1.0 + x)));
+}
+
+S21_SIMD_INLINE Mask NoFallback(Vec x) { return (Mask)x & 0; }
+
+S21_SIMD_INLINE Mask TrigFallback(Vec x) {
+  return ~(Abs(x) <= Splat(kTrigMax));
+}
+
+S21_SIMD_INLINE Mask LogFallback(Vec x) {
+  return ~((x >= Splat(kMinNormal)) & (x <= Splat(kMaxFinite)));
+}
+
+struct NegOp {
+  static S21_SIMD_INLINE Vec Apply(Vec x) { return -x; }
+  static S21_SIMD_INLINE Mask Fallback(Vec x) { return NoFallback(x); }
+  static double Scalar(double x) { return -x; }
+};
+
+struct SqrtOp {
+  static S21_SIMD_INLINE Vec Apply(Vec x) { return Sqrt(x); }
+  static S21_SIMD_INLINE Mask Fallback(Vec x) { return NoFallback(x); }
+  static double Scalar(double x) { return std::sqrt(x); }
+};
+
+struct LnOp {
+  static S21_SIMD_INLINE Vec Apply(Vec x) { return Ln(x); }
+  static S21_SIMD_INLINE Mask Fallback(Vec x) { return LogFallback(x); }
+  static double Scalar(double x) { return std::log(x); }
+};
+
+struct Log10Op {
+  static S21_SIMD_INLINE Vec Apply(Vec x) { return Log10(x); }
+  static S21_SIMD_INLINE Mask Fallback(Vec x) { return LogFallback(x); }
+  static double Scalar(double x) { return std::log10(x); }
+};
+
+struct SinOp {
+  static S21_SIMD_INLINE Vec Apply(Vec x) { return Sin(x); }
+  static S21_SIMD_INLINE Mask Fallback(Vec x) { return TrigFallback(x); }
+  static double Scalar(double x) { return std::sin(x); }
+};
+
+struct CosOp {
+  static S21_SIMD_INLINE Vec Apply(Vec x) { return Cos(x); }
+  static S21_SIMD_INLINE Mask Fallback(Vec x) { return TrigFallback(x); }
+  static double Scalar(double x) { return std::cos(x); }
+};
+
+struct TanOp {
+  static S21_SIMD_INLINE Vec Apply(Vec x) { return Tan(x); }
+  static S21_SIMD_INLINE Mask Fallback(Vec x) { return TrigFallback(x); }
+  static double Scalar(double x) { return std::tan(x); }
+};
+
+struct ArcSinOp {
+  static S21_SIMD_INLINE Vec Apply(Vec x) { return ArcSin(x); }
+  static S21_SIMD_INLINE Mask Fallback(Vec x) { return NoFallback(x); }
+  static double Scalar(double x) { return std::asin(x); }
+};
+
+struct ArcCosOp {
+  static S21_SIMD_INLINE Vec Apply(Vec x) { return ArcCos(x); }
+  static S21_SIMD_INLINE Mask Fallback(Vec x) { return NoFallback(x); }
+  static double Scalar(double x) { return std::acos(x); }
+};
+
+struct ArcTanOp {
+  static S21_SIMD_INLINE Vec Apply(Vec x) { return Atan(x); }
+  static S21_SIMD_INLINE Mask Fallback(Vec x) { return NoFallback(x); }
+  static double Scalar(double x) { return std::atan(x); }
+};
+
+struct AddOp {
+  static S21_SIMD_INLINE Vec Apply(Vec a, Vec b) { return a + b; }
+};
+
+struct SubOp {
+  static S21_SIMD_INLINE Vec Apply(Vec a, Vec b) { return a - b; }
+};
+
+struct MulOp {
+  static S21_SIMD_INLINE Vec Apply(Vec a, Vec b) { return a * b; }
+};
+
+struct DivOp {
+  static S21_SIMD_INLINE Vec Apply(Vec a, Vec b) { return a / b; }
+};
+
+S21_SIMD_INLINE Vec Load(const double *src, size_t count) {
+  Vec x{};
+  __builtin_memcpy(&x, src, count * sizeof(double));
+  return x;
+}
+
+S21_SIMD_INLINE void Store(double *dst, Vec x, size_t count) {
+  __builtin_memcpy(dst, &x, count * sizeof(double));
+}
+
+template <typename Op>
+S21_SIMD_INLINE Vec ApplyWithFallback(Vec x) {
+  Vec y = Op::Apply(x);
+  Mask fallback = Op::Fallback(x);
+  if (Any(fallback)) {
+    for (int lane = 0; lane < kLanes; ++lane) {
+      if (fallback[lane]) {
+        y[lane] = Op::Scalar(x[lane]);
+      }
+    }
+  }
+  return y;
+}
+
+template <typename Op>
+S21_SIMD_INLINE void MapUnary(double *dst, const double *src, size_t count) {
+  size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    Store(dst + i, ApplyWithFallback<Op>(Load(src + i, kLanes)), kLanes);
+  }
+  if (i < count) {
+    Store(dst + i, ApplyWithFallback<Op>(Load(src + i, count - i)),
+          count - i);
+  }
+}
+
+S21_SIMD_INLINE void SinCosWithFallback(Vec x, Vec *sin, Vec *cos) {
+  SinCos(x, sin, cos);
+  Mask fallback = TrigFallback(x);
+  if (Any(fallback)) {
+    for (int lane = 0; lane < kLanes; ++lane) {
+      if (fallback[lane]) {
+        (*sin)[lane] = std::sin(x[lane]);
+        (*cos)[lane] = std::cos(x[lane]);
+      }
+    }
+  }
+}
+
+template <typename Op>
+S21_SIMD_INLINE void MapBinary(double *dst, const double *lhs,
+                               const double *rhs, size_t count) {
+  size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    Store(dst + i, Op::Apply(Load(lhs + i, kLanes), Load(rhs + i, kLanes)),
+          kLanes);
+  }
+  if (i < count) {
+    Store(dst + i,
+          Op::Apply(Load(lhs + i, count - i), Load(rhs + i, count - i)),
+          count - i);
+  }
+}
+
+struct Kernels {
+  static void Neg(double *dst, const double *lhs, const double *,
+                  size_t count) {
+    MapUnary<NegOp>(dst, lhs, count);
+  }
+  static void Sqrt(double *dst, const double *lhs, const double *,
+                   size_t count) {
+    MapUnary<SqrtOp>(dst, lhs, count);
+  }
+  static void Ln(double *dst, const double *lhs, const double *,
+                 size_t count) {
+    MapUnary<LnOp>(dst, lhs, count);
+  }
+  static void Log10(double *dst, const double *lhs, const double *,
+                    size_t count) {
+    MapUnary<Log10Op>(dst, lhs, count);
+  }
+  static void Sin(double *dst, const double *lhs, const double *,
+                  size_t count) {
+    MapUnary<SinOp>(dst, lhs, count);
+  }
+  static void Cos(double *dst, const double *lhs, const double *,
+                  size_t count) {
+    MapUnary<CosOp>(dst, lhs, count);
+  }
+  static void Tan(double *dst, const double *lhs, const double *,
+                  size_t count) {
+    MapUnary<TanOp>(dst, lhs, count);
+  }
+  static void SinCos(double *sin, double *cos, const double *x,
+                     size_t count) {
+    Vec sin_x, cos_x;
+    size_t i = 0;
+    for (; i + kLanes <= count; i += kLanes) {
+      SinCosWithFallback(Load(x + i, kLanes), &sin_x, &cos_x);
+      Store(sin + i, sin_x, kLanes);
+      Store(cos + i, cos_x, kLanes);
+    }
+    if (i < count) {
+      SinCosWithFallback(Load(x + i, count - i), &sin_x, &cos_x);
+      Store(sin + i, sin_x, count - i);
+      Store(cos + i, cos_x, count - i);
+    }
+  }
+  static void Fma(double *dst, const double *lhs, const double *rhs,
+                  const double *addend, size_t count) {
+    size_t i = 0;
+    for (; i + kLanes <= count; i += kLanes) {
+      Store(dst + i,
+            MulAdd(Load(lhs + i, kLanes), Load(rhs + i, kLanes),
+                   Load(addend + i, kLanes)),
+            kLanes);
+    }
+    if (i < count) {
+      size_t rest = count - i;
+      Store(dst + i,
+            MulAdd(Load(lhs + i, rest), Load(rhs + i, rest),
+                   Load(addend + i, rest)),
+            rest);
+    }
+  }
+  static void ArcSin(double *dst, const double *lhs, const double *,
+                     size_t count) {
+    MapUnary<ArcSinOp>(dst, lhs, count);
+  }
+  static void ArcCos(double *dst, const double *lhs, const double *,
+                     size_t count) {
+    MapUnary<ArcCosOp>(dst, lhs, count);
+  }
+  static void ArcTan(double *dst, const double *lhs, const double *,
+                     size_t count) {
+    MapUnary<ArcTanOp>(dst, lhs, count);
+  }
+  static void Add(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    MapBinary<AddOp>(dst, lhs, rhs, count);
+  }
+  static void Sub(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    MapBinary<SubOp>(dst, lhs, rhs, count);
+  }
+  static void Mul(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    MapBinary<MulOp>(dst, lhs, rhs, count);
+  }
+  static void Div(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    MapBinary<DivOp>(dst, lhs, rhs, count);
+  }
+  static void Mod(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::fmod(lhs[i], rhs[i]);
+    }
+  }
+  static void Pow(double *dst, const double *lhs, const double *rhs,
+                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = std::pow(lhs[i], rhs[i]);
+    }
+  }
+};  // struct Kernels
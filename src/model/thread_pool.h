@@ -0,0 +1,56 @@
+#ifndef SRC_MODEL_THREAD_POOL_H_
+#define SRC_MODEL_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace s21 {
+
+// Fixed set of worker threads executing submitted tasks in FIFO order.
+// Tasks must not block on other tasks of the same pool.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t thread_count);
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  // Pool sized to the hardware concurrency, shared by the whole model.
+  static ThreadPool &Shared();
+
+  size_t GetThreadCount() const { return workers_.size(); }
+
+  template <typename Function>
+  std::future<std::invoke_result_t<Function>> Submit(Function function) {
+    using Result = std::invoke_result_t<Function>;
+    auto task =
+        std::make_shared<std::packaged_task<Result()>>(std::move(function));
+    std::future<Result> result = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace([task]() { (*task)(); });
+    }
+    condition_.notify_one();
+    return result;
+  }
+
+ private:
+  void Work();
+
+  std::vector<std::thread> workers_{};
+  std::queue<std::function<void()>> tasks_{};
+  std::mutex mutex_{};
+  std::condition_variable condition_{};
+  bool stopping_{};
+};  // class ThreadPool
+
+}  // namespace s21
+
+#endif  // SRC_MODEL_THREAD_POOL_H_
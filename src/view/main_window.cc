@@ -1,5 +1,8 @@
 #include "main_window.h"
 
+#include <cmath>
+#include <cstring>
+
 #include "./ui_main_window.h"
 
 s21::CalculatorWindow::CalculatorWindow(CalculatorController &controller,
@@ -10,6 +13,7 @@ s21::CalculatorWindow::CalculatorWindow(CalculatorController &controller,
   setFixedSize(415, 725);
   ConnectSlots();
   InitPlot();
+  StartPlotThread();
 }
 
 void s21::CalculatorWindow::InitPlot() {
@@ -23,9 +27,41 @@ void s21::CalculatorWindow::InitPlot() {
   ui_->widget_plot->yAxis->setTickPen(QPen(Qt::gray));
   ui_->widget_plot->xAxis->setTickLabelColor(Qt::gray);
   ui_->widget_plot->yAxis->setTickLabelColor(Qt::gray);
+
+  ui_->widget_plot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+  range_timer_.setSingleShot(true);
+  range_timer_.setInterval(30);
+  connect(&range_timer_, SIGNAL(timeout()), this, SLOT(PlotVisibleRange()));
+  connect(ui_->widget_plot->xAxis, SIGNAL(rangeChanged(QCPRange)), this,
+          SLOT(ScheduleRangeUpdate()));
+  connect(ui_->widget_plot->yAxis, SIGNAL(rangeChanged(QCPRange)), this,
+          SLOT(ScheduleRangeUpdate()));
 }
 
-s21::CalculatorWindow::~CalculatorWindow() { delete ui_; }
+void s21::CalculatorWindow::StartPlotThread() {
+  qRegisterMetaType<std::shared_ptr<PlotJob>>();
+  qRegisterMetaType<std::vector<Dot>>();
+  plot_worker_ = new PlotWorker;
+  plot_worker_->moveToThread(&plot_thread_);
+  connect(&plot_thread_, &QThread::finished, plot_worker_,
+          &QObject::deleteLater);
+  connect(plot_worker_, &PlotWorker::Progress, this,
+          &CalculatorWindow::ShowPlotProgress);
+  connect(plot_worker_, &PlotWorker::Preview, this,
+          &CalculatorWindow::ShowPlotPreview);
+  connect(plot_worker_, &PlotWorker::Finished, this,
+          &CalculatorWindow::ShowPlot);
+  connect(plot_worker_, &PlotWorker::Analysed, this,
+          &CalculatorWindow::ShowAnalysis);
+  plot_thread_.start();
+}
+
+s21::CalculatorWindow::~CalculatorWindow() {
+  CancelPlot();
+  plot_thread_.quit();
+  plot_thread_.wait();
+  delete ui_;
+}
 
 void s21::CalculatorWindow::keyPressEvent(QKeyEvent *event) {
   if (event->modifiers() == Qt::ControlModifier && event->key() == Qt::Key_W) {
@@ -83,11 +119,17 @@ void s21::CalculatorWindow::ConnectSlots() {
   connect(ui_->button_ac, SIGNAL(clicked()), this, SLOT(ClearAll()));
   connect(ui_->button_bs, SIGNAL(clicked()), this, SLOT(DeleteLastSymbol()));
   connect(ui_->button_plot, SIGNAL(clicked()), this, SLOT(CreatePlot()));
+  connect(ui_->line_expr, SIGNAL(textChanged(QString)), this,
+          SLOT(CancelPlot()));
+  connect(ui_->check_box_derivative, SIGNAL(toggled(bool)), this,
+          SLOT(ScheduleRangeUpdate()));
   connect(ui_->button_calculate, SIGNAL(clicked()), this, SLOT(Calculate()));
   connect(sc_equal, SIGNAL(activated()), this, SLOT(Calculate()));
 }
 
 void s21::CalculatorWindow::ClearAll() {
+  CancelPlot();
+  plotted_expression_.clear();
   ui_->line_expr->setText("");
   ui_->line_res->setText("");
   ui_->widget_plot->clearGraphs();
@@ -105,6 +147,18 @@ void s21::CalculatorWindow::Calculate() {
   std::string expression = ui_->line_expr->text().toStdString();
   std::string result = controller_.Calculate(expression);
   ui_->line_res->setText(QString::fromStdString(result));
+  ShowDerivatives(expression);
+}
+
+void s21::CalculatorWindow::ShowDerivatives(const std::string &expression) {
+  Dual result = controller_.Differentiate(expression);
+  if (std::isfinite(result.value)) {
+    ui_->statusbar->showMessage(QString("f'(X) = %1    f''(X) = %2")
+                                    .arg(result.first, 0, 'g', 10)
+                                    .arg(result.second, 0, 'g', 10));
+  } else {
+    ui_->statusbar->clearMessage();
+  }
 }
 
 void s21::CalculatorWindow::CreatePlot() {
@@ -119,25 +173,144 @@ void s21::CalculatorWindow::CreatePlot() {
 
   ui_->line_res->setText(QString::fromStdString(result));
 
-  std::pair<std::list<double>, std::list<double>> dots =
-      controller_.CalculateDots(expression, plot_limits);
-
-  ui_->widget_plot->clearGraphs();
-
+  plotted_expression_ = expression;
+  setting_range_ = true;
   ui_->widget_plot->xAxis->setRange(x_min, x_max);
   ui_->widget_plot->yAxis->setRange(y_min, y_max);
+  setting_range_ = false;
+  StartPlot(plot_limits);
+}
+
+void s21::CalculatorWindow::StartPlot(const std::vector<double> &plot_limits) {
+  CancelPlot();
+  plot_job_ = controller_.CalculateDotsAsync(plotted_expression_, plot_limits);
+  plot_job_->SetDerivative(ui_->check_box_derivative->isChecked() ? 1 : 0);
+  QRect axis_rect = ui_->widget_plot->axisRect()->rect();
+  double pixel_ratio = ui_->widget_plot->devicePixelRatioF();
+  plot_job_->SetViewport(
+      static_cast<size_t>(std::ceil(axis_rect.width() * pixel_ratio)),
+      static_cast<size_t>(std::ceil(axis_rect.height() * pixel_ratio)));
+  QMetaObject::invokeMethod(
+      plot_worker_,
+      [worker = plot_worker_, job = plot_job_]() { worker->Run(job); },
+      Qt::QueuedConnection);
+  ui_->statusbar->showMessage("Plotting...");
+}
+
+void s21::CalculatorWindow::ScheduleRangeUpdate() {
+  if (!setting_range_ && !plotted_expression_.empty()) {
+    range_timer_.start();
+  }
+}
+
+void s21::CalculatorWindow::PlotVisibleRange() {
+  QCPRange x_range = ui_->widget_plot->xAxis->range();
+  QCPRange y_range = ui_->widget_plot->yAxis->range();
+  StartPlot({x_range.lower, x_range.upper, y_range.lower, y_range.upper});
+}
+
+void s21::CalculatorWindow::CancelPlot() {
+  if (plot_job_) {
+    plot_job_->Cancel();
+    plot_job_.reset();
+    ui_->statusbar->clearMessage();
+  }
+}
+
+void s21::CalculatorWindow::ShowPlotProgress(std::shared_ptr<PlotJob> job,
+                                             double progress) {
+  if (job && job == plot_job_) {
+    ui_->statusbar->showMessage(
+        QString("Plotting... %1%").arg(static_cast<int>(progress * 100)));
+  }
+}
+
+void s21::CalculatorWindow::ShowPlotPreview(std::shared_ptr<PlotJob> job,
+                                            std::vector<Dot> dots) {
+  if (job && job == plot_job_) {
+    DrawDots(dots);
+  }
+}
+
+// The job stays current until its roots and integral arrive, so that a
+// new plot still cancels it.
+void s21::CalculatorWindow::ShowPlot(std::shared_ptr<PlotJob> job) {
+  if (job != plot_job_) {
+    return;
+  }
+  if (job->IsPartial()) {
+    ui_->statusbar->showMessage("Plot is not fully refined: out of budget");
+  } else {
+    ui_->statusbar->clearMessage();
+  }
+  DrawDots(job->TakeDots());
+}
+
+void s21::CalculatorWindow::ShowAnalysis(std::shared_ptr<PlotJob> job) {
+  if (job != plot_job_) {
+    return;
+  }
+  plot_job_.reset();
+  const std::vector<double> &plot_limits = job->GetPlotLimits();
+  if (!job->IsPartial()) {
+    ShowIntegral(plot_limits[0], plot_limits[1], job->GetIntegral());
+  }
+  if (!job->GetRoots().empty()) {
+    DrawRoots(job->GetRoots());
+  }
+}
+
+void s21::CalculatorWindow::ShowIntegral(double a, double b,
+                                         Integral result) {
+  if (std::isfinite(result.value)) {
+    ui_->statusbar->showMessage(QString("Integral on [%1, %2] = %3 +/- %4")
+                                    .arg(a, 0, 'g', 6)
+                                    .arg(b, 0, 'g', 6)
+                                    .arg(result.value, 0, 'g', 10)
+                                    .arg(result.error, 0, 'g', 2));
+  } else {
+    ui_->statusbar->clearMessage();
+  }
+}
+
+void s21::CalculatorWindow::DrawRoots(const std::vector<double> &roots) {
+  QVector<double> x;
+  for (double root : roots) {
+    x.append(root);
+  }
+  QCPGraph *markers = ui_->widget_plot->addGraph();
+  markers->setData(x, QVector<double>(x.size(), 0.0), true);
+  markers->setLineStyle(QCPGraph::lsNone);
+  markers->setScatterStyle(
+      QCPScatterStyle(QCPScatterStyle::ssCircle, Qt::blue, Qt::white, 7));
+  ui_->widget_plot->replot();
+}
+
+void s21::CalculatorWindow::DrawDots(const std::vector<Dot> &dots) {
+  ui_->widget_plot->clearGraphs();
   ui_->widget_plot->addGraph();
-  QList<double> dots_x(dots.first.begin(), dots.first.end());
-  QList<double> dots_y(dots.second.begin(), dots.second.end());
-  ui_->widget_plot->graph(0)->addData(dots_x, dots_y, true);
+  ui_->widget_plot->graph(0)->setData(MakeGraphData(dots));
   FormatPlotLine();
   ui_->widget_plot->replot();
 }
 
+QSharedPointer<QCPGraphDataContainer> s21::CalculatorWindow::MakeGraphData(
+    const std::vector<Dot> &dots) {
+  static_assert(sizeof(Dot) == sizeof(QCPGraphData),
+                "Dot must match the QCPGraphData layout");
+  QVector<QCPGraphData> graph_data(static_cast<int>(dots.size()));
+  std::memcpy(static_cast<void *>(graph_data.data()), dots.data(),
+              dots.size() * sizeof(Dot));
+  QSharedPointer<QCPGraphDataContainer> container(new QCPGraphDataContainer);
+  container->set(graph_data, true);
+  return container;
+}
+
 void s21::CalculatorWindow::FormatPlotLine() {
   QPen pen(Qt::red);
   ui_->widget_plot->graph(0)->setPen(pen);
-  ui_->widget_plot->graph(0)->setLineStyle(QCPGraph::lsNone);
+  // Breaks in the curve come as NaN dots, which QCPGraph leaves as gaps.
+  ui_->widget_plot->graph(0)->setLineStyle(QCPGraph::lsLine);
   ui_->widget_plot->graph(0)->setScatterStyle(
-      QCPScatterStyle(QCPScatterStyle::ssDisc, 1.5));
+      QCPScatterStyle(QCPScatterStyle::ssNone));
 }
\ No newline at end of file
@@ -4,11 +4,15 @@
 #include <QKeyEvent>
 #include <QMainWindow>
 #include <QShortcut>
-#include <list>
+#include <QThread>
+#include <QTimer>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "../controller/main_controller.h"
 #include "../rcs/qcustomplot/qcustomplot.h"
+#include "plot_worker.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -30,9 +34,24 @@ class CalculatorWindow : public QMainWindow {
  private:
   Ui::MainWindow *ui_;
   CalculatorController &controller_;
+  QThread plot_thread_;
+  PlotWorker *plot_worker_{};
+  std::shared_ptr<PlotJob> plot_job_{};
+  // Expression on screen, resampled when the axes are dragged or zoomed.
+  std::string plotted_expression_{};
+  QTimer range_timer_;
+  bool setting_range_{};
   void ConnectSlots();
   void InitPlot();
+  void StartPlotThread();
   void FormatPlotLine();
+  void ShowDerivatives(const std::string &expression);
+  void ShowIntegral(double a, double b, Integral result);
+  void StartPlot(const std::vector<double> &plot_limits);
+  void DrawDots(const std::vector<Dot> &dots);
+  void DrawRoots(const std::vector<double> &roots);
+  static QSharedPointer<QCPGraphDataContainer> MakeGraphData(
+      const std::vector<Dot> &dots);
 
  private slots:
   void PrintSymbols();
@@ -40,6 +59,14 @@ class CalculatorWindow : public QMainWindow {
   void DeleteLastSymbol();
   void Calculate();
   void CreatePlot();
+  void CancelPlot();
+  void ScheduleRangeUpdate();
+  void PlotVisibleRange();
+  void ShowPlotProgress(std::shared_ptr<s21::PlotJob> job, double progress);
+  void ShowPlotPreview(std::shared_ptr<s21::PlotJob> job,
+                       std::vector<s21::Dot> dots);
+  void ShowPlot(std::shared_ptr<s21::PlotJob> job);
+  void ShowAnalysis(std::shared_ptr<s21::PlotJob> job);
 
 };  // class CalculatorWindow
 
@@ -0,0 +1,23 @@
+#include "plot_worker.h"
+
+#include <utility>
+
+void s21::PlotWorker::Run(std::shared_ptr<PlotJob> job) {
+  if (job->IsCancelled()) {
+    return;
+  }
+  std::weak_ptr<PlotJob> weak_job = job;
+  job->SetProgressCallback([this, weak_job](double progress) {
+    emit Progress(weak_job.lock(), progress);
+  });
+  job->SetPreviewCallback([this, weak_job](std::vector<Dot> dots) {
+    emit Preview(weak_job.lock(), std::move(dots));
+  });
+  if (!job->Run()) {
+    return;
+  }
+  emit Finished(job);
+  if (job->Analyse()) {
+    emit Analysed(job);
+  }
+}
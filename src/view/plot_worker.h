@@ -0,0 +1,38 @@
+#ifndef SRC_VIEW_PLOT_WORKER_H
+#define SRC_VIEW_PLOT_WORKER_H
+
+#include <QMetaType>
+#include <QObject>
+#include <memory>
+#include <vector>
+
+#include "../model/plot.h"
+
+Q_DECLARE_METATYPE(std::shared_ptr<s21::PlotJob>)
+Q_DECLARE_METATYPE(std::vector<s21::Dot>)
+
+namespace s21 {
+
+// Lives on the plotting thread and runs one job at a time, reporting back
+// to the window through queued signals. Once the dots are delivered the
+// roots and the integral of the job are found on the same thread.
+class PlotWorker : public QObject {
+  Q_OBJECT
+
+ public:
+  using QObject::QObject;
+
+ public slots:
+  void Run(std::shared_ptr<s21::PlotJob> job);
+
+ signals:
+  void Progress(std::shared_ptr<s21::PlotJob> job, double progress);
+  void Preview(std::shared_ptr<s21::PlotJob> job, std::vector<s21::Dot> dots);
+  void Finished(std::shared_ptr<s21::PlotJob> job);
+  void Analysed(std::shared_ptr<s21::PlotJob> job);
+
+};  // class PlotWorker
+
+}  // namespace s21
+
+#endif  // SRC_VIEW_PLOT_WORKER_H
@@ -2,7 +2,13 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <thread>
+
+#include "../src/model/interval.h"
+#include "../src/model/simd_kernels.h"
 
 using namespace s21;
 
@@ -43,8 +49,7 @@ class CalcTest : public testing::Test {
   std::string graph_func_ = "1/X";
   std::string graph_func_fail_ = "cocos(X)";
   std::vector<double> plot_limits_ = {-30, 30, -100, 100};
-  std::pair<std::list<double>, std::list<double>> dots_;
-  std::list<double> dots_x_, dots_y_;
+  std::vector<Dot> dots_;
 };
 
 TEST_F(CalcTest, DivisionByZeroFail) {
@@ -120,25 +125,913 @@ TEST_F(CalcTest, VariableXSuccess) {
   EXPECT_EQ(calc_.GetResultString(), x_str_res_);
 }
 
+TEST_F(CalcTest, DeepNestingSuccess) {
+  calc_.SetXValue(1);
+  calc_.Calculate("1+(2*(3-(4/(5+(6^(X mod 7))))))");
+  EXPECT_EQ(calc_.GetResultString(), "6.27272727");
+  calc_.SetXValue(0);
+  calc_.Calculate("1+(2*(3-(4/(5+(6^(X mod 7))))))");
+  EXPECT_EQ(calc_.GetResultString(), "5.66666667");
+}
+
+TEST_F(CalcTest, BatchSuccess) {
+  std::vector<double> x_values(1000);
+  std::vector<double> results(x_values.size());
+  for (size_t i = 0; i < x_values.size(); ++i) {
+    x_values[i] = -5.0 + 0.01 * static_cast<double>(i);
+  }
+  EXPECT_TRUE(calc_.CalculateBatch(x_str_main_, x_values.data(),
+                                   results.data(), x_values.size()));
+  for (size_t i = 0; i < x_values.size(); ++i) {
+    double expected = std::sqrt((7.2 + 3.5 - 2.8) / (5.6 * 4.2)) +
+                      std::sin(x_values[i]) - std::cos(1.3);
+    EXPECT_NEAR(results[i], expected, 1e-12);
+  }
+}
+
+TEST_F(CalcTest, DerivativeSuccess) {
+  struct Case {
+    std::string expression;
+    double x, first, second;
+  };
+  std::vector<Case> cases = {
+      {"X^3-2*X", 2, 10, 12},
+      {"sin(X)*cos(X)", 0.5, std::cos(1.0), -2 * std::sin(1.0)},
+      {"ln(X)/X", 2, (1 - std::log(2.0)) / 4, (2 * std::log(2.0) - 3) / 8},
+      {"sqrt(1+X^2)", 1, 1 / std::sqrt(2.0), 1 / std::pow(2.0, 1.5)},
+      {"atan(X)+asin(X/2)", 1, 0.5 + 1 / std::sqrt(3.0),
+       -0.5 + 0.125 / std::pow(0.75, 1.5)},
+      {"2^X", 1, 2 * std::log(2.0), 2 * std::log(2.0) * std::log(2.0)},
+      {"log(X)+tan(X)", 1,
+       1 / std::log(10.0) + 1 / (std::cos(1.0) * std::cos(1.0)),
+       -1 / std::log(10.0) +
+           2 * std::tan(1.0) / (std::cos(1.0) * std::cos(1.0))},
+      {"(-X)^2", -3, -6, 2},
+      {"X mod 2", 5, 1, 0}};
+  for (const Case &test : cases) {
+    calc_.SetXValue(test.x);
+    Dual result = calc_.Differentiate(test.expression);
+    calc_.Calculate(test.expression);
+    EXPECT_NEAR(result.value, std::stod(calc_.GetResultString()), 1e-6)
+        << test.expression;
+    EXPECT_NEAR(result.first, test.first, 1e-12) << test.expression;
+    EXPECT_NEAR(result.second, test.second, 1e-12) << test.expression;
+  }
+}
+
+TEST_F(CalcTest, DerivativeFail) {
+  EXPECT_TRUE(std::isnan(calc_.Differentiate(err_abracadabra_).first));
+}
+
+TEST_F(CalcTest, FindRootsSuccess) {
+  std::vector<double> roots = calc_.FindRoots("X^3-X", -2, 2);
+  ASSERT_EQ(roots.size(), 3U);
+  EXPECT_DOUBLE_EQ(roots[0], -1);
+  EXPECT_NEAR(roots[1], 0, 1e-15);
+  EXPECT_DOUBLE_EQ(roots[2], 1);
+
+  roots = calc_.FindRoots("X^2-2", -3, 3);
+  ASSERT_EQ(roots.size(), 2U);
+  EXPECT_DOUBLE_EQ(roots[0], -std::sqrt(2.0));
+  EXPECT_DOUBLE_EQ(roots[1], std::sqrt(2.0));
+
+  roots = calc_.FindRoots("sin(X)", -10, 10);
+  ASSERT_EQ(roots.size(), 7U);
+  for (size_t i = 0; i < roots.size(); ++i) {
+    EXPECT_NEAR(roots[i], (static_cast<double>(i) - 3) * M_PI, 1e-14);
+  }
+}
+
+TEST_F(CalcTest, FindRootsFail) {
+  EXPECT_TRUE(calc_.FindRoots("1/X", -1, 1).empty());
+  EXPECT_TRUE(calc_.FindRoots("X^2+1", -5, 5).empty());
+  EXPECT_TRUE(calc_.FindRoots(err_abracadabra_, -5, 5).empty());
+  EXPECT_TRUE(calc_.FindRoots("X", 1, -1).empty());
+}
+
+TEST_F(CalcTest, IntegrateSuccess) {
+  struct Case {
+    std::string expression;
+    double a, b, expected;
+  };
+  std::vector<Case> cases = {{"sin(X)", 0, M_PI, 2},
+                             {"X^2", 0, 1, 1.0 / 3},
+                             {"X^2", 1, 0, -1.0 / 3},
+                             {"sqrt(X)", 0, 1, 2.0 / 3},
+                             {"ln(X)", 0, 1, -1},
+                             {"1/(1+X^2)", -100, 100, 2 * std::atan(100.0)},
+                             {"sin(X)^2", 0, 100, 50 - std::sin(200.0) / 4},
+                             {"X", 2, 2, 0}};
+  for (const Case &test : cases) {
+    Integral result = calc_.Integrate(test.expression, test.a, test.b);
+    EXPECT_NEAR(result.value, test.expected, 1e-9) << test.expression;
+    EXPECT_LE(std::fabs(result.value - test.expected),
+              std::max(result.error, 1e-14))
+        << test.expression;
+    EXPECT_LE(result.error, 1e-9) << test.expression;
+  }
+}
+
+TEST_F(CalcTest, IntegrateFail) {
+  EXPECT_TRUE(std::isnan(calc_.Integrate(err_abracadabra_, 0, 1).value));
+  EXPECT_GT(calc_.Integrate("1/X^2", -1, 1).error, 1);
+}
+
+TEST_F(CalcTest, BatchFail) {
+  std::vector<double> x_values = {1, 2, 3};
+  std::vector<double> results(x_values.size());
+  EXPECT_FALSE(calc_.CalculateBatch(graph_func_fail_, x_values.data(),
+                                    results.data(), x_values.size()));
+  EXPECT_TRUE(std::isnan(results[0]));
+}
+
 TEST_F(CalcTest, ModTestSuccess) {
   calc_.Calculate(mod_);
   EXPECT_EQ(calc_.GetResultString(), mod_res_);
 }
 
+TEST_F(CalcTest, ErrorPositionFail) {
+  calc_.Calculate(err_abracadabra_);
+  EXPECT_EQ(calc_.GetErrorPosition(), 4U);
+  calc_.Calculate("(1+2");
+  EXPECT_EQ(calc_.GetErrorPosition(), 0U);
+  calc_.Calculate("sin(1)*");
+  EXPECT_EQ(calc_.GetErrorPosition(), 7U);
+  calc_.Calculate("2(3)");
+  EXPECT_EQ(calc_.GetErrorPosition(), 1U);
+  calc_.Calculate("1+2)");
+  EXPECT_EQ(calc_.GetErrorPosition(), 3U);
+  calc_.Calculate("1.2.3");
+  EXPECT_EQ(calc_.GetResultString(), error_);
+}
+
+TEST_F(CalcTest, ErrorPositionSuccess) {
+  calc_.Calculate(mod_);
+  EXPECT_EQ(calc_.GetResultString(), mod_res_);
+  EXPECT_EQ(calc_.GetErrorPosition(), std::string::npos);
+}
+
+TEST_F(CalcTest, CacheHitSuccess) {
+  calc_.SetXValue(x_d_);
+  calc_.Calculate(x_str_main_);
+  calc_.SetXValue(0);
+  calc_.Calculate(x_str_main_);
+  calc_.SetXValue(x_d_);
+  calc_.Calculate(x_str_main_);
+  EXPECT_EQ(calc_.GetResultString(), x_str_res_);
+  EXPECT_EQ(calc_.GetCacheMisses(), 1U);
+  EXPECT_EQ(calc_.GetCacheHits(), 2U);
+}
+
+TEST_F(CalcTest, CacheEvictionSuccess) {
+  calc_.SetCacheCapacity(1);
+  calc_.Calculate(simple_log_);
+  calc_.Calculate(err_abracadabra_);
+  calc_.Calculate(err_abracadabra_);
+  EXPECT_EQ(calc_.GetResultString(), error_);
+  calc_.Calculate(simple_log_);
+  EXPECT_EQ(calc_.GetResultString(), simple_log_res_);
+  EXPECT_EQ(calc_.GetCacheMisses(), 3U);
+  EXPECT_EQ(calc_.GetCacheHits(), 1U);
+}
+
+TEST_F(CalcTest, ConstantFoldingSuccess) {
+  calc_.Calculate(multifold_);
+  EXPECT_EQ(calc_.GetResultString(), multifold_res_);
+  EXPECT_EQ(calc_.GetInstructionCount(), 0U);
+  calc_.Calculate(functions_t_);
+  EXPECT_EQ(calc_.GetResultString(), functions_res_);
+  EXPECT_EQ(calc_.GetInstructionCount(), 0U);
+
+  calc_.SetXValue(1.5);
+  calc_.Calculate("sqrt((7.2+3.5-2.8)/(5.6*4.2))+sin(X)-cos(1.3)");
+  EXPECT_EQ(calc_.GetInstructionCount(), 3U);
+  calc_.Calculate("-(-X)*1-0");
+  EXPECT_EQ(calc_.GetResultString(), "1.5");
+  EXPECT_EQ(calc_.GetInstructionCount(), 0U);
+  calc_.Calculate("(X/1-0)^1+X^0");
+  EXPECT_EQ(calc_.GetResultString(), "2.5");
+  EXPECT_EQ(calc_.GetInstructionCount(), 1U);
+  calc_.Calculate("(X+1)^3");
+  EXPECT_EQ(calc_.GetResultString(), "15.625");
+  EXPECT_EQ(calc_.GetInstructionCount(), 3U);
+}
+
+TEST_F(CalcTest, SignedZeroSuccess) {
+  calc_.SetXValue(0);
+  calc_.Calculate("0-X");
+  EXPECT_EQ(calc_.GetResultString(), "0");
+  calc_.Calculate("-X*X+0");
+  EXPECT_EQ(calc_.GetResultString(), "0");
+  calc_.SetXValue(-0.0);
+  calc_.Calculate("X+0");
+  EXPECT_EQ(calc_.GetResultString(), "0");
+  calc_.Calculate("X-0");
+  EXPECT_EQ(calc_.GetResultString(), "-0");
+}
+
+TEST_F(CalcTest, CommonSubexpressionSuccess) {
+  std::string expression = "sin(X)+sin(X)*cos(X)+(X^2+1)/(X^2+1)";
+  auto reference = [](double x) {
+    return std::sin(x) + std::sin(x) * std::cos(x) + 1;
+  };
+  calc_.SetXValue(0.7);
+  calc_.Calculate(expression);
+  EXPECT_EQ(calc_.GetInstructionCount(), 5U);
+  EXPECT_NEAR(std::stod(calc_.GetResultString()), reference(0.7), 1e-7);
+
+  std::vector<double> x_values(1000);
+  std::vector<double> results(x_values.size());
+  for (size_t i = 0; i < x_values.size(); ++i) {
+    x_values[i] = -50.0 + 0.1 * static_cast<double>(i);
+  }
+  EXPECT_TRUE(calc_.CalculateBatch(expression, x_values.data(),
+                                   results.data(), x_values.size()));
+  for (size_t i = 0; i < x_values.size(); ++i) {
+    EXPECT_NEAR(results[i], reference(x_values[i]), 1e-14);
+  }
+}
+
+TEST_F(CalcTest, PolynomialSuccess) {
+  struct Case {
+    std::string expression;
+    size_t instructions;
+    double (*reference)(double);
+  };
+  std::vector<Case> cases = {
+      {"X^4", 2, [](double x) { return std::pow(x, 4); }},
+      {"X^10", 1, [](double x) { return std::pow(x, 10); }},
+      {"X^-3", 3, [](double x) { return std::pow(x, -3); }},
+      {"X^0.5", 1, [](double x) { return std::sqrt(x); }},
+      {"3*X^4-2*X^3+X^2-5*X+7", 4,
+       [](double x) { return 3 * std::pow(x, 4) - 2 * std::pow(x, 3) +
+                             x * x - 5 * x + 7; }},
+      {"X^3+X^2+X+1", 3,
+       [](double x) { return x * x * x + x * x + x + 1; }},
+      {"(X-1)^4", 3, [](double x) { return std::pow(x - 1, 4); }}};
+  std::vector<double> x_values(1000);
+  std::vector<double> results(x_values.size());
+  for (size_t i = 0; i < x_values.size(); ++i) {
+    x_values[i] = 0.01 + 0.01 * static_cast<double>(i);
+  }
+  for (const Case &test : cases) {
+    calc_.Calculate(test.expression);
+    EXPECT_EQ(calc_.GetInstructionCount(), test.instructions)
+        << test.expression;
+    EXPECT_TRUE(calc_.CalculateBatch(test.expression, x_values.data(),
+                                     results.data(), x_values.size()));
+    for (size_t i = 0; i < x_values.size(); ++i) {
+      double expected = test.reference(x_values[i]);
+      EXPECT_NEAR(results[i], expected, 1e-14 * std::fabs(expected))
+          << test.expression << " x = " << x_values[i];
+    }
+  }
+  calc_.SetXValue(2);
+  Dual result = calc_.Differentiate("3*X^4-2*X^3+X^2-5*X+7");
+  EXPECT_DOUBLE_EQ(result.value, 33);
+  EXPECT_DOUBLE_EQ(result.first, 71);
+  EXPECT_DOUBLE_EQ(result.second, 122);
+}
+
+TEST_F(CalcTest, LargePowerSuccess) {
+  calc_.SetXValue(3.3);
+  calc_.Calculate("X^60");
+  EXPECT_EQ(calc_.GetResultString(), "12907329373697541983808583106560");
+  double x_value = 3.3;
+  double result = 0;
+  for (int n = -64; n <= 64; ++n) {
+    std::string expression = "X^" + std::to_string(n);
+    EXPECT_TRUE(calc_.CalculateBatch(expression, &x_value, &result, 1));
+    if (std::abs(n) > 4) {
+      EXPECT_EQ(result, std::pow(x_value, n)) << expression;
+    }
+  }
+}
+
+TEST_F(CalcTest, FusedMultiplyAddSuccess) {
+  struct Case {
+    std::string expression;
+    size_t instructions;
+    double (*reference)(double);
+  };
+  std::vector<Case> cases = {
+      {"X*X+sin(X)*3-5", 4,
+       [](double x) { return x * x + std::sin(x) * 3 - 5; }},
+      {"1-2*X", 1, [](double x) { return 1 - 2 * x; }},
+      {"X*sin(X)-4", 2, [](double x) { return x * std::sin(x) - 4; }},
+      {"sin(X)*cos(X)+sin(X)*cos(X)", 3,
+       [](double x) { return 2 * std::sin(x) * std::cos(x); }}};
+  std::vector<double> x_values(1000);
+  std::vector<double> results(x_values.size());
+  for (size_t i = 0; i < x_values.size(); ++i) {
+    x_values[i] = -5.0 + 0.01 * static_cast<double>(i);
+  }
+  for (const Case &test : cases) {
+    calc_.SetXValue(0.25);
+    calc_.Calculate(test.expression);
+    EXPECT_EQ(calc_.GetInstructionCount(), test.instructions)
+        << test.expression;
+    EXPECT_NEAR(std::stod(calc_.GetResultString()), test.reference(0.25),
+                1e-7)
+        << test.expression;
+    EXPECT_TRUE(calc_.CalculateBatch(test.expression, x_values.data(),
+                                     results.data(), x_values.size()));
+    for (size_t i = 0; i < x_values.size(); ++i) {
+      EXPECT_NEAR(results[i], test.reference(x_values[i]), 1e-13)
+          << test.expression << " x = " << x_values[i];
+    }
+  }
+}
+
+TEST(CompilerTest, HoistingSuccess) {
+  Compiler compiler;
+  Compiler::Node x = compiler.AddVariable();
+  Compiler::Node p = compiler.AddParameter(8);
+  Compiler::Node root = compiler.AddOperation(
+      OpCode::kSub,
+      compiler.AddOperation(
+          OpCode::kAdd,
+          compiler.AddOperation(
+              OpCode::kSqrt,
+              compiler.AddOperation(OpCode::kMul, p,
+                                    compiler.AddConstant(2))),
+          compiler.AddOperation(OpCode::kSin, x)),
+      compiler.AddOperation(OpCode::kCos, p));
+  auto program = std::make_shared<Program>();
+  compiler.Emit(root, *program);
+  EXPECT_EQ(program->GetInstructions().size(), 3U);
+  EXPECT_EQ(program->GetInvariantInstructions().size(), 3U);
+  ASSERT_EQ(program->GetParameters().size(), 1U);
+
+  Evaluator evaluator(program);
+  EXPECT_DOUBLE_EQ(evaluator.Evaluate(1), 4 + std::sin(1.0) - std::cos(8.0));
+  evaluator.SetParameter(0, 2);
+  EXPECT_DOUBLE_EQ(evaluator.Evaluate(1), 2 + std::sin(1.0) - std::cos(2.0));
+  double x_values[] = {0, 1};
+  double y_values[2] = {};
+  evaluator.EvaluateBatch(x_values, y_values, 2);
+  EXPECT_DOUBLE_EQ(y_values[1], 2 + std::sin(1.0) - std::cos(2.0));
+  EXPECT_DOUBLE_EQ(evaluator.EvaluateDual(1).first, std::cos(1.0));
+  EXPECT_TRUE(evaluator.EvaluateInterval({0, 1}).Contains(y_values[1]));
+
+  Compiler invariant;
+  Compiler::Node q = invariant.AddParameter(3);
+  auto scaled = std::make_shared<Program>();
+  invariant.Emit(invariant.AddOperation(OpCode::kMul, q, q), *scaled);
+  EXPECT_TRUE(scaled->GetInstructions().empty());
+  EXPECT_DOUBLE_EQ(Evaluator(scaled).Evaluate(0), 9);
+}
+
 TEST_F(CalcTest, PlotTestSuccess) {
   calc_.CalculateDots(graph_func_, plot_limits_);
-  dots_ = calc_.GetDots();
-  dots_x_ = dots_.first;
-  dots_y_ = dots_.second;
-  EXPECT_FALSE(dots_x_.empty());
-  EXPECT_FALSE(dots_y_.empty());
+  dots_ = calc_.TakeDots();
+  EXPECT_FALSE(dots_.empty());
+  EXPECT_TRUE(calc_.TakeDots().empty());
 }
 
 TEST_F(CalcTest, PlotTestFail) {
   calc_.CalculateDots(graph_func_fail_, plot_limits_);
   EXPECT_EQ(calc_.GetResultString(), "Error");
-  EXPECT_TRUE(dots_x_.empty());
-  EXPECT_TRUE(dots_y_.empty());
+  EXPECT_TRUE(calc_.TakeDots().empty());
+  EXPECT_FALSE(calc_.IsPlotPartial());
+
+  PlotBudget budget;
+  budget.max_evaluations = 1;
+  budget.time_limit = std::chrono::steady_clock::duration::zero();
+  std::shared_ptr<PlotJob> job =
+      calc_.PreparePlot(graph_func_fail_, plot_limits_, budget);
+  job->SetPreviewCallback([](std::vector<Dot>) { ADD_FAILURE(); });
+  EXPECT_TRUE(job->Run());
+  EXPECT_TRUE(job->TakeDots().empty());
+  EXPECT_FALSE(job->IsPartial());
+  EXPECT_EQ(job->GetEvaluations(), 0U);
+}
+
+TEST_F(CalcTest, PlotOrderSuccess) {
+  calc_.CalculateDots(graph_func_, plot_limits_);
+  dots_ = calc_.TakeDots();
+  EXPECT_TRUE(std::is_sorted(
+      dots_.begin(), dots_.end(),
+      [](const Dot &lhs, const Dot &rhs) { return lhs.x < rhs.x; }));
+  calc_.CalculateDots(graph_func_, plot_limits_);
+  std::vector<Dot> again = calc_.TakeDots();
+  ASSERT_EQ(again.size(), dots_.size());
+  for (size_t i = 0; i < dots_.size(); ++i) {
+    EXPECT_EQ(again[i].x, dots_[i].x);
+  }
+}
+
+TEST_F(CalcTest, PlotJobSuccess) {
+  std::shared_ptr<PlotJob> job = calc_.PreparePlot(graph_func_, plot_limits_);
+  double last_progress = 0;
+  job->SetProgressCallback([&last_progress](double progress) {
+    EXPECT_GT(progress, last_progress);
+    last_progress = progress;
+  });
+  std::thread worker([job]() { EXPECT_TRUE(job->Run()); });
+  worker.join();
+  EXPECT_EQ(last_progress, 1.0);
+  EXPECT_EQ(job->GetProgress(), 1.0);
+  EXPECT_FALSE(job->TakeDots().empty());
+}
+
+TEST_F(CalcTest, PlotPreviewSuccess) {
+  std::shared_ptr<PlotJob> job = calc_.PreparePlot(graph_func_, plot_limits_);
+  std::vector<size_t> sizes;
+  job->SetPreviewCallback([&sizes](std::vector<Dot> dots) {
+    sizes.push_back(dots.size());
+    EXPECT_EQ(dots.front().x, -30);
+    EXPECT_EQ(dots.back().x, 30);
+    EXPECT_DOUBLE_EQ(dots[1].y, 1 / dots[1].x);
+  });
+  EXPECT_TRUE(job->Run());
+  EXPECT_EQ(sizes, (std::vector<size_t>{38, 75, 149}));
+  EXPECT_FALSE(job->TakeDots().empty());
+}
+
+TEST_F(CalcTest, PlotDecimationSuccess) {
+  std::shared_ptr<PlotJob> job =
+      calc_.PreparePlot("sin(1/X)", {-1, 1, -2, 2});
+  job->SetViewport(40, 1000);
+  EXPECT_TRUE(job->Run());
+  dots_ = job->TakeDots();
+  EXPECT_LE(dots_.size(), 40U * 4);
+  auto highest = std::max_element(
+      dots_.begin(), dots_.end(),
+      [](const Dot &lhs, const Dot &rhs) { return lhs.y < rhs.y; });
+  EXPECT_GT(highest->y, 0.99);
+}
+
+TEST_F(CalcTest, PlotAdaptiveSuccess) {
+  std::vector<double> plot_limits = {-1, 1, -1.5, 1.5};
+  std::shared_ptr<PlotJob> flat = calc_.PreparePlot("2*X+1", plot_limits);
+  EXPECT_TRUE(flat->Run());
+  std::shared_ptr<PlotJob> wavy = calc_.PreparePlot("sin(1/X)", plot_limits);
+  EXPECT_TRUE(wavy->Run());
+  // 2 units at 256 columns per unit, three nodes, two interval bounds and
+  // two midpoints a tile.
+  EXPECT_LE(flat->GetEvaluations(), 2 * 256 / Plot::kTileColumns * 7);
+  EXPECT_GT(wavy->GetEvaluations(), flat->GetEvaluations() * 2);
+  EXPECT_LE(wavy->GetEvaluations(),
+            Plot::kEvaluationsPerColumn * Plot::kDefaultWidth + 256);
+}
+
+TEST_F(CalcTest, PlotBudgetFail) {
+  PlotBudget budget;
+  budget.max_evaluations = 256;
+  calc_.CalculateDots("sin(1/X)", {-1, 1, -1.5, 1.5}, budget);
+  EXPECT_TRUE(calc_.IsPlotPartial());
+  dots_ = calc_.TakeDots();
+  EXPECT_EQ(dots_.front().x, -1);
+  EXPECT_EQ(dots_.back().x, 1);
+
+  budget.max_evaluations = 0;
+  budget.time_limit = std::chrono::steady_clock::duration::zero();
+  calc_.CalculateDots("sin(1/X)", {-1, 1, -1.5, 1.5}, budget);
+  EXPECT_TRUE(calc_.IsPlotPartial());
+  EXPECT_FALSE(calc_.TakeDots().empty());
+
+  calc_.CalculateDots(graph_func_, plot_limits_);
+  EXPECT_FALSE(calc_.IsPlotPartial());
+}
+
+TEST_F(CalcTest, PlotDeadlineFail) {
+  PlotBudget budget;
+  budget.max_evaluations = 1000000000;
+  budget.time_limit = std::chrono::steady_clock::duration::zero();
+  std::shared_ptr<PlotJob> job =
+      calc_.PreparePlot("tan(X)*sin(1/X)", {-1, 1, -1.5, 1.5}, budget);
+  EXPECT_TRUE(job->Run());
+  EXPECT_TRUE(job->IsPartial());
+  // The clock is read before the first refinement of each tile, so only
+  // the three grid nodes of each of the 32 tiles are sampled.
+  EXPECT_LE(job->GetEvaluations(), 2 * 256 / Plot::kTileColumns * 3);
+}
+
+TEST_F(CalcTest, PlotPreviewBudgetFail) {
+  PlotBudget budget;
+  budget.max_evaluations = 50;
+  std::shared_ptr<PlotJob> job =
+      calc_.PreparePlot("sin(1/X)", {-1, 1, -1.5, 1.5}, budget);
+  size_t previews = 0;
+  job->SetPreviewCallback([&previews](std::vector<Dot>) { ++previews; });
+  EXPECT_TRUE(job->Run());
+  // Only the coarsest preview level fits in the budget.
+  EXPECT_EQ(previews, 1U);
+  EXPECT_TRUE(job->IsPartial());
+  EXPECT_FALSE(job->TakeDots().empty());
+}
+
+TEST_F(CalcTest, PlotLimitsFail) {
+  double infinity = std::numeric_limits<double>::infinity();
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  std::vector<std::vector<double>> limits = {
+      {1, -1, -1, 1},         {-1, 1, 2, 2},
+      {-1, 1, 1, -1},         {0, 1e-320, -1, 1},
+      {-infinity, 1, -1, 1},  {-1, 1, nan, 1},
+      {-1e308, 1e308, -1, 1}, {-1, 1}};
+  for (const std::vector<double> &plot_limits : limits) {
+    calc_.CalculateDots(graph_func_, plot_limits);
+    EXPECT_TRUE(calc_.TakeDots().empty());
+    EXPECT_TRUE(calc_.IsPlotPartial());
+    std::shared_ptr<PlotJob> job = calc_.PreparePlot(graph_func_, plot_limits);
+    job->SetPreviewCallback([](std::vector<Dot>) { ADD_FAILURE(); });
+    EXPECT_TRUE(job->Run());
+    EXPECT_TRUE(job->TakeDots().empty());
+    EXPECT_TRUE(job->IsPartial());
+  }
+}
+
+TEST_F(CalcTest, PlotAnalysisSuccess) {
+  std::vector<double> plot_limits = {-2, 2, -2, 2};
+  std::shared_ptr<PlotJob> job = calc_.PreparePlot("X^2-1", plot_limits);
+  EXPECT_TRUE(job->Run());
+  EXPECT_TRUE(job->Analyse());
+  ASSERT_EQ(job->GetRoots().size(), 2U);
+  EXPECT_NEAR(job->GetRoots()[0], -1, 1e-12);
+  EXPECT_NEAR(job->GetRoots()[1], 1, 1e-12);
+  EXPECT_NEAR(job->GetIntegral().value, 4.0 / 3, 1e-12);
+
+  job = calc_.PreparePlot("X^2-1", plot_limits);
+  job->SetDerivative(1);
+  EXPECT_TRUE(job->Run());
+  EXPECT_TRUE(job->Analyse());
+  EXPECT_TRUE(job->GetRoots().empty());
+
+  PlotBudget budget;
+  budget.max_evaluations = 1;
+  job = calc_.PreparePlot("sin(1/X)", plot_limits, budget);
+  EXPECT_TRUE(job->Run());
+  EXPECT_TRUE(job->IsPartial());
+  EXPECT_TRUE(job->Analyse());
+  EXPECT_FALSE(job->GetRoots().empty());
+  EXPECT_TRUE(std::isnan(job->GetIntegral().value));
+
+  job = calc_.PreparePlot("X^2-1", plot_limits);
+  job->Cancel();
+  EXPECT_FALSE(job->Analyse());
+  EXPECT_TRUE(job->GetRoots().empty());
+}
+
+TEST_F(CalcTest, PlotTileCacheSuccess) {
+  calc_.CalculateDots("sin(X)", {-30, 30, -2, 2});
+  dots_ = calc_.TakeDots();
+  size_t misses = calc_.GetTileMisses();
+  calc_.CalculateDots("sin(X)", {-20, 40, -2, 2});
+  std::vector<Dot> panned = calc_.TakeDots();
+  EXPECT_GT(calc_.GetTileHits(), 0U);
+  EXPECT_LT(calc_.GetTileMisses() - misses, misses / 4);
+  auto overlap = std::find_if(panned.begin(), panned.end(),
+                              [](const Dot &dot) { return dot.x >= -20; });
+  ASSERT_NE(overlap, panned.end());
+  EXPECT_DOUBLE_EQ(overlap->y, std::sin(overlap->x));
+
+  std::shared_ptr<PlotJob> zoomed =
+      calc_.PreparePlot("sin(X)", {-10, 10, -2, 2});
+  size_t previews = 0;
+  zoomed->SetPreviewCallback([&previews](std::vector<Dot> dots) {
+    EXPECT_FALSE(dots.empty());
+    ++previews;
+  });
+  size_t hits = calc_.GetTileHits();
+  EXPECT_TRUE(zoomed->Run());
+  EXPECT_EQ(previews, 1U);
+  EXPECT_GT(calc_.GetTileHits(), hits);
+}
+
+TEST_F(CalcTest, PlotPoleSuccess) {
+  calc_.CalculateDots(graph_func_, plot_limits_);
+  dots_ = calc_.TakeDots();
+  size_t breaks = 0;
+  for (size_t i = 1; i < dots_.size(); ++i) {
+    if (std::isnan(dots_[i].y)) {
+      ++breaks;
+      EXPECT_NEAR(dots_[i].x, 0, 1e-9);
+    } else if (!std::isnan(dots_[i - 1].y)) {
+      EXPECT_FALSE(dots_[i - 1].x < 0 && dots_[i].x > 0);
+    }
+  }
+  EXPECT_EQ(breaks, 1U);
+}
+
+TEST_F(CalcTest, PlotDomainEdgeSuccess) {
+  calc_.CalculateDots("sqrt(X)", {-1, 1, -2, 2});
+  dots_ = calc_.TakeDots();
+  auto edge = std::find_if(dots_.begin(), dots_.end(), [](const Dot &dot) {
+    return !std::isnan(dot.y);
+  });
+  ASSERT_NE(edge, dots_.end());
+  EXPECT_NEAR(edge->x, 0, 1e-9);
+  EXPECT_TRUE(std::isnan(std::prev(edge)->y));
+}
+
+TEST_F(CalcTest, PlotCullingSuccess) {
+  std::vector<double> plot_limits = {-1, 1, -2, 2};
+  std::shared_ptr<PlotJob> visible =
+      calc_.PreparePlot("sin(50*X)", plot_limits);
+  EXPECT_TRUE(visible->Run());
+  std::shared_ptr<PlotJob> hidden =
+      calc_.PreparePlot("sin(50*X)+100", plot_limits);
+  EXPECT_TRUE(hidden->Run());
+  EXPECT_LT(hidden->GetEvaluations() * 4, visible->GetEvaluations());
+  dots_ = hidden->TakeDots();
+  EXPECT_EQ(dots_.front().x, -1);
+  EXPECT_EQ(dots_.back().x, 1);
+}
+
+TEST_F(CalcTest, PlotDerivativeSuccess) {
+  std::vector<double> plot_limits = {-2, 2, -5, 5};
+  std::shared_ptr<PlotJob> value = calc_.PreparePlot("X^3", plot_limits);
+  EXPECT_TRUE(value->Run());
+  std::shared_ptr<PlotJob> slope = calc_.PreparePlot("X^3", plot_limits);
+  slope->SetDerivative(1);
+  EXPECT_TRUE(slope->Run());
+  dots_ = slope->TakeDots();
+  ASSERT_FALSE(dots_.empty());
+  for (const Dot &dot : dots_) {
+    EXPECT_NEAR(dot.y, 3 * dot.x * dot.x, 1e-12);
+  }
+  EXPECT_NE(value->TakeDots().size(), 0U);
+}
+
+TEST_F(CalcTest, PlotJobCancelFail) {
+  std::shared_ptr<PlotJob> job = calc_.PreparePlot(graph_func_, plot_limits_);
+  job->Cancel();
+  EXPECT_FALSE(job->Run());
+  EXPECT_TRUE(job->IsCancelled());
+  EXPECT_TRUE(job->TakeDots().empty());
+}
+
+double UlpDistance(double got, double expected) {
+  if (got == expected || (std::isnan(got) && std::isnan(expected))) {
+    return 0;
+  }
+  int exponent = 0;
+  std::frexp(expected, &exponent);
+  return std::fabs(got - expected) / std::ldexp(1.0, exponent - 53);
+}
+
+TEST(SimdKernelsTest, UlpBoundsSuccess) {
+  struct Case {
+    OpCode code;
+    double (*reference)(double);
+    double from, to, max_ulp;
+  };
+  std::vector<Case> cases = {
+      {OpCode::kSin, std::sin, -10, 10, 1},
+      {OpCode::kSin, std::sin, -5e5, 5e5, 2},
+      {OpCode::kCos, std::cos, -10, 10, 1},
+      {OpCode::kCos, std::cos, -5e5, 5e5, 2},
+      {OpCode::kTan, std::tan, -5e5, 5e5, 3},
+      {OpCode::kLn, std::log, 1e-3, 1e3, 1},
+      {OpCode::kLog10, std::log10, 1e-3, 1e3, 2},
+      {OpCode::kArcTan, std::atan, -50, 50, 1},
+      {OpCode::kArcSin, std::asin, -1, 1, 2},
+      {OpCode::kArcCos, std::acos, -1, 1, 2},
+      {OpCode::kSqrt, std::sqrt, 0, 1e6, 0}};
+  std::vector<double> x(100003), y(x.size());
+  for (const KernelSet *kernels : SupportedKernels()) {
+    for (const Case &test : cases) {
+      for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = test.from + (test.to - test.from) * static_cast<double>(i) /
+                               static_cast<double>(x.size() - 1);
+      }
+      kernels->Get(test.code)(y.data(), x.data(), nullptr, x.size());
+      for (size_t i = 0; i < x.size(); ++i) {
+        ASSERT_LE(UlpDistance(y[i], test.reference(x[i])), test.max_ulp)
+            << kernels->GetName() << " x = " << x[i];
+      }
+    }
+  }
+}
+
+TEST(SimdKernelsTest, SinCosSuccess) {
+  std::vector<double> x = {0.0, -0.0, 1e-310, 0.5, -3.0, 1e5, 1e20, INFINITY};
+  for (size_t i = 0; i < 1000; ++i) {
+    x.push_back(-20.0 + 0.04 * static_cast<double>(i));
+  }
+  std::vector<double> sin(x.size()), cos(x.size());
+  std::vector<double> sin_fused(x.size()), cos_fused(x.size());
+  for (const KernelSet *kernels : SupportedKernels()) {
+    kernels->Get(OpCode::kSin)(sin.data(), x.data(), nullptr, x.size());
+    kernels->Get(OpCode::kCos)(cos.data(), x.data(), nullptr, x.size());
+    kernels->GetSinCos()(sin_fused.data(), cos_fused.data(), x.data(),
+                         x.size());
+    for (size_t i = 0; i < x.size(); ++i) {
+      EXPECT_EQ(UlpDistance(sin_fused[i], sin[i]), 0)
+          << kernels->GetName() << " x = " << x[i];
+      EXPECT_EQ(UlpDistance(cos_fused[i], cos[i]), 0)
+          << kernels->GetName() << " x = " << x[i];
+    }
+  }
+}
+
+TEST(SimdKernelsTest, FmaSuccess) {
+  double tiny = std::ldexp(1.0, -30);
+  std::vector<double> lhs = {1 + tiny, 0.1, -3, INFINITY, 2, 1e300, 5};
+  std::vector<double> rhs = {1 - tiny, 10, 7, 0, NAN, 1e10, -0.5};
+  std::vector<double> addend = {-1, -1, 21, 1, 1, -INFINITY, 2.5};
+  std::vector<double> result(lhs.size());
+  for (const KernelSet *kernels : SupportedKernels()) {
+    kernels->GetFma()(result.data(), lhs.data(), rhs.data(), addend.data(),
+                      lhs.size());
+    for (size_t i = 0; i < lhs.size(); ++i) {
+      EXPECT_EQ(UlpDistance(result[i], std::fma(lhs[i], rhs[i], addend[i])),
+                0)
+          << kernels->GetName() << " i = " << i;
+    }
+    EXPECT_EQ(result[0], -tiny * tiny);
+  }
+}
+
+TEST(SimdKernelsTest, SelectKernelsSuccess) {
+  EXPECT_STREQ(SelectKernels("scalar").GetName(), "scalar");
+  EXPECT_STREQ(SelectKernels("unknown").GetName(),
+               SupportedKernels().back()->GetName());
+  EXPECT_STREQ(SelectKernels(nullptr).GetName(),
+               SupportedKernels().back()->GetName());
+  EXPECT_FALSE(CalculatorModel().GetKernelsName().empty());
+}
+
+TEST(SimdKernelsTest, SpecialValuesSuccess) {
+  std::vector<double> x = {0.0, -0.0, INFINITY, -INFINITY, NAN, -1.0, 1e-310};
+  std::vector<double> y(x.size());
+  const KernelSet &kernels = DefaultKernels();
+  kernels.Get(OpCode::kLn)(y.data(), x.data(), nullptr, x.size());
+  EXPECT_EQ(y[0], -INFINITY);
+  EXPECT_EQ(y[2], INFINITY);
+  EXPECT_TRUE(std::isnan(y[4]));
+  EXPECT_TRUE(std::isnan(y[5]));
+  EXPECT_DOUBLE_EQ(y[6], std::log(1e-310));
+  kernels.Get(OpCode::kSin)(y.data(), x.data(), nullptr, x.size());
+  EXPECT_TRUE(std::signbit(y[1]));
+  EXPECT_TRUE(std::isnan(y[2]));
+  EXPECT_TRUE(std::isnan(y[4]));
+}
+
+TEST(JitTest, BackendsAgreeSuccess) {
+  std::vector<std::shared_ptr<Program>> programs;
+  auto emit = [&](Compiler &compiler, Compiler::Node root) {
+    programs.push_back(std::make_shared<Program>());
+    compiler.Emit(root, *programs.back());
+  };
+  for (OpCode code : {OpCode::kNeg, OpCode::kSqrt, OpCode::kLn,
+                      OpCode::kLog10, OpCode::kSin, OpCode::kCos,
+                      OpCode::kTan, OpCode::kArcSin, OpCode::kArcCos,
+                      OpCode::kArcTan}) {
+    Compiler compiler;
+    Compiler::Node x = compiler.AddVariable();
+    emit(compiler, compiler.AddOperation(
+                       code, compiler.AddOperation(OpCode::kMul, x,
+                                                   compiler.AddConstant(0.1))));
+  }
+  for (OpCode code : {OpCode::kAdd, OpCode::kSub, OpCode::kMul,
+                      OpCode::kDiv, OpCode::kMod, OpCode::kPow}) {
+    Compiler compiler;
+    Compiler::Node x = compiler.AddVariable();
+    emit(compiler, compiler.AddOperation(
+                       code, compiler.AddOperation(OpCode::kSin, x), x));
+  }
+  Compiler compiler;
+  Compiler::Node x = compiler.AddVariable();
+  Compiler::Node p = compiler.AddParameter(3);
+  emit(compiler,
+       compiler.AddOperation(
+           OpCode::kAdd,
+           compiler.AddOperation(OpCode::kMul,
+                                 compiler.AddOperation(OpCode::kSin, x),
+                                 compiler.AddOperation(OpCode::kCos, x)),
+           compiler.AddOperation(
+               OpCode::kSub, compiler.AddOperation(OpCode::kSqrt, p),
+               compiler.AddOperation(OpCode::kMul, x, p))));
+
+  std::vector<double> x_values(1000);
+  std::vector<double> interpreted(x_values.size());
+  std::vector<double> compiled(x_values.size());
+  for (size_t i = 0; i < x_values.size(); ++i) {
+    x_values[i] = -10.0 + 0.02 * static_cast<double>(i);
+  }
+  for (const auto &program : programs) {
+    Evaluator interpreter(program);
+    interpreter.SetJitThreshold(std::numeric_limits<size_t>::max());
+    Evaluator jit(program);
+    jit.SetJitThreshold(1);
+    for (double x_value : x_values) {
+      ASSERT_EQ(UlpDistance(jit.Evaluate(x_value),
+                            interpreter.Evaluate(x_value)),
+                0)
+          << "x = " << x_value;
+    }
+#if defined(__x86_64__)
+    EXPECT_TRUE(jit.IsCompiled());
+#endif
+    EXPECT_FALSE(interpreter.IsCompiled());
+    interpreter.EvaluateBatch(x_values.data(), interpreted.data(),
+                              x_values.size());
+    jit.EvaluateBatch(x_values.data(), compiled.data(), x_values.size());
+    for (size_t i = 0; i < x_values.size(); ++i) {
+      ASSERT_EQ(UlpDistance(compiled[i], interpreted[i]), 0)
+          << "x = " << x_values[i];
+    }
+    for (const KernelSet *kernels : SupportedKernels()) {
+      std::unique_ptr<JitCode> code =
+          JitCode::Compile(*program, *kernels, Evaluator::kBlockSize);
+      std::string name = kernels->GetName();
+      if (code) {
+        EXPECT_EQ(code->HasBlock(), name == "avx2" || name == "avx512")
+            << name;
+      }
+    }
+  }
+}
+
+TEST_F(CalcTest, JitDefaultSettingsSuccess) {
+  if (DefaultJitThreshold() > kJitThreshold) {
+    GTEST_SKIP();
+  }
+  calc_.CalculateDots("sin(X)*X", {-100, 100, -100, 100});
+  calc_.TakeDots();
+#if defined(__x86_64__)
+  EXPECT_TRUE(calc_.IsCompiled());
+#endif
+  calc_.Integrate("sin(X*X)", 0, 50);
+  calc_.Calculate("sin(X*X)");
+#if defined(__x86_64__)
+  EXPECT_TRUE(calc_.IsCompiled());
+#endif
+}
+
+TEST(IntervalTest, BoundsSuccess) {
+  using Unary = Interval (*)(Interval);
+  using Binary = Interval (*)(Interval, Interval);
+  struct UnaryCase {
+    Unary bound;
+    double (*reference)(double);
+  };
+  struct BinaryCase {
+    Binary bound;
+    double (*reference)(double, double);
+  };
+  std::vector<UnaryCase> unary = {
+      {interval::Sqrt, std::sqrt},   {interval::Ln, std::log},
+      {interval::Log10, std::log10}, {interval::Sin, std::sin},
+      {interval::Cos, std::cos},     {interval::Tan, std::tan},
+      {interval::ArcSin, std::asin}, {interval::ArcCos, std::acos},
+      {interval::ArcTan, std::atan}};
+  std::vector<BinaryCase> binary = {
+      {interval::Add, [](double a, double b) { return a + b; }},
+      {interval::Sub, [](double a, double b) { return a - b; }},
+      {interval::Mul, [](double a, double b) { return a * b; }},
+      {interval::Div, [](double a, double b) { return a / b; }},
+      {interval::Mod, std::fmod},
+      {interval::Pow, std::pow}};
+  std::vector<Interval> ranges = {{-7, 7},     {-1.5, 0.5}, {0.25, 3},
+                                  {1.4, 1.75}, {-3, -2},    {2, 2},
+                                  {-0.5, 0.5}, {0, 1},      {-2, -2},
+                                  {1, 1.05},   {0.1, 0.1}};
+  auto points = [](Interval range) {
+    std::vector<double> x;
+    for (int i = 0; i <= 64; ++i) {
+      x.push_back(range.lo + (range.hi - range.lo) * i / 64);
+    }
+    return x;
+  };
+  for (Interval range : ranges) {
+    for (const UnaryCase &test : unary) {
+      Interval bounds = test.bound(range);
+      ASSERT_TRUE(bounds.IsEmpty() || bounds.lo <= bounds.hi);
+      for (double x : points(range)) {
+        double y = test.reference(x);
+        if (!std::isnan(y)) {
+          ASSERT_TRUE(bounds.Contains(y)) << range.lo << " " << x;
+        }
+      }
+    }
+    for (Interval other : ranges) {
+      for (const BinaryCase &test : binary) {
+        Interval bounds = test.bound(range, other);
+        ASSERT_TRUE(bounds.IsEmpty() || bounds.lo <= bounds.hi)
+            << range.lo << " " << other.lo;
+        for (double x : points(range)) {
+          for (double z : points(other)) {
+            double y = test.reference(x, z);
+            if (!std::isnan(y) && !std::isinf(y)) {
+              ASSERT_TRUE(bounds.Contains(y)) << x << " " << z;
+            }
+          }
+        }
+      }
+    }
+  }
+  EXPECT_TRUE(interval::Sqrt({-2, -1}).IsEmpty());
+  EXPECT_TRUE(interval::Div({1, 2}, {0, 0}).IsEmpty());
+  Interval mod_bounds = interval::Mod({1, 1.05}, {0.1, 0.1});
+  EXPECT_LE(mod_bounds.lo, 0.05);
+  EXPECT_GE(mod_bounds.hi, std::fmod(1, 0.1));
+  Interval sin_bounds = interval::Sin({0, 1});
+  EXPECT_LT(sin_bounds.hi, 0.85);
+  EXPECT_GT(sin_bounds.lo, -1e-300);
+  EXPECT_EQ(interval::Tan({1, 2}).hi, INFINITY);
 }
 
 int main(int argc, char *argv[]) {